@@ -64,7 +64,7 @@ void ApplyDynStep<Derived, ApplyGame, Solver>::setup_assignment() {
     for (unsigned int i = 0; i < _solver->n_terminals(); ++i) {
 	const PointMove* newmove = update_pointmove(i);
 	alpha.reset(AssignmentFlyFactory::make(
-	    new ObjAssignment(alpha.get(), _solver->terminal_symbol(i), newmove)));
+	    ObjAssignment::make(alpha.get(), _solver->terminal_symbol(i), newmove)));
     }
 
     DEBUG({
@@ -48,7 +48,7 @@ ApplyGameForget<Solver>::init() {
 		<< " --> " << std::endl
 		<< newsmove->toString());
 	alpha.reset(AssignmentFlyFactory::make(
-	    new SetAssignment(alpha.get(), sym, newsmove)));
+	    SetAssignment::make(alpha.get(), sym, newsmove)));
         const ConstantSymbol *tmp_symbol = create_temporary_symbol(sym->nesting_depth() + 1);
         assert(_forgotten_ts != NULL);
         assert(tmp_symbol != NULL);
@@ -59,21 +59,12 @@ ApplyGameForget<Solver>::init() {
     _alpha = alpha->clone();
 }
 
+/**
+ * Compute the result for oldgame and store it in the cache.
+ */
 template <typename Solver>
 const MCGame_f *
 ApplyGameForget<Solver>::result(const MCGame_f* oldgame) {
-    /* 
-     * The new alpha already contains the node and its full adjacency
-     * (via the terminal moves).  Use this to look up an entry in the cache.
-     */
-    const MCGame_f *cached = cache_forget_lookup(oldgame->get()->formula(),
-                                                 _alpha, oldgame, _forgotten_ts);
-    if (cached != NULL) {
-	DPRINTLN("Forget Cache hit");
-	DPRINTLN("Cache result: " << cached->get()->toString());
-	return cached;
-    }
-
     const MCGame_f* newgame = oldgame->get()->forget(_forgotten_ts,
 						     _solver->signature_depth(),
                                                      _replacement,
@@ -96,8 +87,19 @@ ApplyGameForget<Solver>::operator()(const GameVoidPtrMap::value_type &entry) {
     DPRINT("Next Input: Game" << oldgame->get()->toString());
     DPRINTLN("\twith value: " << _solver->evaluation()->toString(oldvalue));
 
-    const MCGame_f *res = result(oldgame);
-    _solver->table(_node)->update_value(_alpha, res, oldvalue);
+    /* 
+     * The new alpha already contains the node and its full adjacency
+     * (via the terminal moves).  Use this to look up an entry in the cache.
+     */
+    CachePin<CacheForgetValue> cached = cache_forget_lookup(oldgame->get()->formula(),
+							    _alpha, oldgame, _forgotten_ts);
+    if (!cached.empty()) {
+	DPRINTLN("Forget Cache hit");
+	DPRINTLN("Cache result: " << cached->get()->toString());
+	_solver->table(_node)->update_value_borrowed(_alpha, cached.get(), oldvalue);
+    } else {
+	_solver->table(_node)->update_value(_alpha, result(oldgame), oldvalue);
+    }
     _count++;
 }
 
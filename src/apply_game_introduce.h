@@ -58,7 +58,7 @@ private:
     size_t _count;
 #endif
 
-    const CacheIntroduceValue* results(const MCGame_f* oldgame);
+    const CacheIntroduceValue* compute_results(const MCGame_f* oldgame);
     void save_value(const Assignment_f* alpha,
 		    const MCGame_f* game,
 		    const void *oldvalue) const;
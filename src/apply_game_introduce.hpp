@@ -49,7 +49,7 @@ ApplyGameIntroduce<Solver>::compute_intersection(const Assignment_f *alpha) cons
 	    tmpsmove->remove(_intro_ts);
 	const SetMove* newsmove = moves_pool.pool(tmpsmove);
 	result.reset(AssignmentFlyFactory::make(
-	    new SetAssignment(result.get(), sym, newsmove)));
+	    SetAssignment::make(result.get(), sym, newsmove)));
     }
     return result->clone();
 }
@@ -67,33 +67,18 @@ ApplyGameIntroduce<Solver>::save_value(const Assignment_f* alpha,
     const void *intersec_elem = _solver->evaluation()->elem(_bag, intersection.get()->get());
     const void *new_elem = _solver->evaluation()->elem(_bag, alpha->get());
     const void *val = _solver->evaluation()->mult(oldvalue, new_elem, intersec_elem);
-    _solver->table(_node)->update_value(alpha, game, val);
+    _solver->table(_node)->update_value_borrowed(alpha, game, val);
 }
 
+/**
+ * Compute the results for oldgame and store them in the cache.
+ */
 template <typename Solver>
 const CacheIntroduceValue*
-ApplyGameIntroduce<Solver>::results(const MCGame_f* oldgame) {
-    /* 
-     * The new alpha already contains the node and its full adjacency
-     * (via the terminal moves).  Use this to look up an entry in the cache.
-     */
+ApplyGameIntroduce<Solver>::compute_results(const MCGame_f* oldgame) {
     const Assignment_f* alpha = _solver->alpha(_node);
-    const CacheIntroduceValue* cached = cache_introduce_lookup(oldgame->get()->formula(),
-                                                               alpha, oldgame, _intro_ts);
-    if (cached != NULL) {
-	DPRINTLN("Introduce Cache hit");
-	typename CacheIntroduceValue::const_iterator it;
-	DEBUG({
-	    for (it = cached->begin(); it != cached->end(); it++) {
-		const MCGame_f *cached_game = it->second;
-		DPRINTLN("Cache result: " << cached_game->get()->toString());
-	    }
-	});
-	return cached;
-    }
-
     /*
-     * Otherwise, prepare an entry: For each of the 2^{|free_vars|} ways
+     * Prepare an entry: For each of the 2^{|free_vars|} ways
      * to introduce the new terminal, create a new table entry.
      */
     CacheIntroduceValue *res = new CacheIntroduceValue();
@@ -113,7 +98,7 @@ ApplyGameIntroduce<Solver>::results(const MCGame_f* oldgame) {
 	    DPRINTLN(oldsmove->toString() << " --> " << newsmove->toString());
 	    assert(!my_alpha->get()->assigned(sym));
 	    my_alpha.reset(AssignmentFlyFactory::make(
-		new SetAssignment(my_alpha.get(), sym, newsmove)));
+		SetAssignment::make(my_alpha.get(), sym, newsmove)));
 	    assert(my_alpha->get()->assigned(sym));
 	}
 	const MCGame_f *newgame = oldgame->get()->introduce(_intro_ts,
@@ -147,13 +132,27 @@ ApplyGameIntroduce<Solver>::operator()(const GameVoidPtrMap::value_type &entry)
     DEBUG(oldgame->get()->recursive_print_game(0, true));
     DPRINTLN("");
 
-    const CacheIntroduceValue *reslist = results(oldgame);
+    /* 
+     * The new alpha already contains the node and its full adjacency
+     * (via the terminal moves).  Use this to look up an entry in the cache.
+     */
+    CachePin<CacheIntroduceValue> cached =
+	cache_introduce_lookup(oldgame->get()->formula(), _solver->alpha(_node),
+			       oldgame, _intro_ts);
+    const CacheIntroduceValue *reslist = cached.get();
+    if (reslist != NULL) {
+	DPRINTLN("Introduce Cache hit");
+    } else {
+	reslist = compute_results(oldgame);
+    }
     typename CacheIntroduceValue::const_iterator it;
     for (it = reslist->begin(); it != reslist->end(); it++) {
-	save_value(it->first, it->second->clone(), oldvalue);
+	DPRINTLN("Result: " << it->second->get()->toString());
+	save_value(it->first, it->second, oldvalue);
         _count++;
     }
-    delete reslist;
+    if (cached.empty())
+	delete reslist;
 }
 
 } // namespace
\ No newline at end of file
@@ -22,9 +22,10 @@
 #ifndef SEQUOIA_APPLY_GAME_JOIN_H
 #define SEQUOIA_APPLY_GAME_JOIN_H
 
-#include "pair_iterator_stl.h"
 #include "sequoia_solver.h"
 
+#include <utility>
+
 namespace sequoia {
 
 template <typename Solver>
@@ -37,7 +38,8 @@ public:
 	_bag = _solver->treedecomposition()->bag(node);
         _count = 0UL;
     }
-    typedef PairIteratorStl<GameVoidPtrMap::const_iterator, GameVoidPtrMap::const_iterator>::value_type argument_type;
+    typedef std::pair<const MCGame_f*, const void*> game_value_type;
+    typedef std::pair<game_value_type, game_value_type> argument_type;
     void init();
     void operator() (const argument_type &entry);
     size_t count() const { return _count; }
@@ -54,7 +56,8 @@ private:
 #endif
 
     const MCGame_f* result(const MCGame_f* game_left, const MCGame_f* game_right);
-    void save_value(const MCGame_f* result, const void *value_left, const void *value_right) const;
+    void save_value(const MCGame_f* result, bool owned,
+                    const void *value_left, const void *value_right) const;
     ApplyGameJoin<Solver>(const ApplyGameJoin<Solver> &other); // forbid
 };
 
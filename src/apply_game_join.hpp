@@ -33,17 +33,12 @@ ApplyGameJoin<Solver>::init() {
     _intersection = _solver->evaluation()->elem(_bag, _alpha->get());
 }
 
+/**
+ * Compute the joined game and store it in the cache.
+ */
 template <typename Solver>
 const MCGame_f *
 ApplyGameJoin<Solver>::result(const MCGame_f* game_left, const MCGame_f* game_right) {
-    const MCGame_f *cached = cache_join_lookup(game_left->get()->formula(),
-                                               _alpha, game_left, game_right);
-    if (cached != NULL) {
-	DPRINTLN("Join Cache hit");
-	DPRINTLN("Cache result: " << cached->get()->toString());
-        DEBUG(cached->get()->recursive_print_game(0, true));
-	return cached;
-    }
     const MCGame_f* resgame = game_left->get()->join(game_right, _alpha);
     DPRINTLN("Result:");
     DEBUG(resgame->get()->recursive_print_game(0, true));
@@ -68,23 +63,36 @@ ApplyGameJoin<Solver>::operator()(const argument_type &entry) {
     DPRINTLN("\twith value: " << _solver->evaluation()->toString(value_right) << " and game:");
     DEBUG(game_right->get()->recursive_print_game(1, true));
 
-    const MCGame_f *res = result(game_left, game_right);
-    save_value(res, value_left, value_right);
+    CachePin<CacheJoinValue> cached = cache_join_lookup(game_left->get()->formula(),
+							_alpha, game_left, game_right);
+    if (!cached.empty()) {
+	DPRINTLN("Join Cache hit");
+	DPRINTLN("Cache result: " << cached->get()->toString());
+        DEBUG(cached->get()->recursive_print_game(0, true));
+	save_value(cached.get(), false, value_left, value_right);
+    } else {
+	save_value(result(game_left, game_right), true, value_left, value_right);
+    }
     _count++;
 }
 
 /**
- * deletes the result game, do not delete elsewhere
+ * If owned, deletes the result game, do not delete elsewhere
  */
 template <typename Solver>
 void
-ApplyGameJoin<Solver>::save_value(const MCGame_f* result, const void* value_left, const void* value_right) const {
+ApplyGameJoin<Solver>::save_value(const MCGame_f* result, bool owned,
+				  const void* value_left, const void* value_right) const {
     if (result->get()->outcome() == MCGame::FALSIFIER) {
-	delete result;
+	if (owned)
+	    delete result;
 	return;
     }
     const void *val = _solver->evaluation()->mult(value_left, value_right, _intersection);
-    _solver->table(_node)->update_value(_alpha, result, val);
+    if (owned)
+	_solver->table(_node)->update_value(_alpha, result, val);
+    else
+	_solver->table(_node)->update_value_borrowed(_alpha, result, val);
 }
 
 } // namespace
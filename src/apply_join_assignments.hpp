@@ -21,17 +21,56 @@
  */
 #include "apply_join_assignments.h"
 #include "apply_game_join.h"
-#include "lightweight_apply.h"
-#include "pair_iterator_stl.h"
 
-#include <algorithm>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 #ifdef HAVE_TBB
-#include <tbb/parallel_do.h>
+#include <tbb/blocked_range2d.h>
+#include <tbb/parallel_for.h>
 #endif
 
 namespace sequoia {
 
+namespace internal {
+
+/**
+ * Copy the (game, value) pairs of a GameVoidPtrMap into a contiguous
+ * array, such that the Cartesian product can be split into tiles.
+ */
+template <typename GameValue>
+void
+snapshot_games(const GameVoidPtrMap *map, std::vector<GameValue> &out) {
+    out.clear();
+    GameVoidPtrMap::const_iterator it = map->begin();
+    GameVoidPtrMap::const_iterator itend = map->end();
+    for (; it != itend; ++it)
+        out.push_back(GameValue(it->first, it->second));
+}
+
+#ifdef HAVE_TBB
+/**
+ * Joins all pairs of games in a tile of the left x right product.
+ */
+template <typename Apply>
+class ApplyJoinTile {
+public:
+    typedef std::vector<typename Apply::game_value_type> Games;
+    ApplyJoinTile(Apply *apply, const Games *left, const Games *right)
+    : _apply(apply), _left(left), _right(right) { }
+    void operator()(const tbb::blocked_range2d<size_t> &tile) const {
+        for (size_t i = tile.rows().begin(); i != tile.rows().end(); ++i)
+            for (size_t j = tile.cols().begin(); j != tile.cols().end(); ++j)
+                (*_apply)(std::make_pair((*_left)[i], (*_right)[j]));
+    }
+private:
+    Apply *_apply;
+    const Games *_left;
+    const Games *_right;
+};
+#endif
+
+} // namespace internal
+
 template <typename Solver>
 void
 ApplyJoinAssignment<Solver>::operator()(const SequoiaTable::const_iterator::value_type &entry) {
@@ -39,8 +78,8 @@ ApplyJoinAssignment<Solver>::operator()(const SequoiaTable::const_iterator::valu
     const GameVoidPtrMap *left_inmap = entry.second;
 
     SequoiaTable *right_table = _solver->table(_child_right);
-    SequoiaTable::const_iterator ralpha_it = right_table->find(alpha);
-    if (ralpha_it == right_table->end()) {
+    const SequoiaTable::value_type *ralpha_it = right_table->find(alpha);
+    if (ralpha_it == NULL) {
 	// no compatible entries in the right table, no need to iterate.
 	return;
     }
@@ -51,17 +90,24 @@ ApplyJoinAssignment<Solver>::operator()(const SequoiaTable::const_iterator::valu
     
     /*
      * Now we iterate over all games in a Cartesian manner and for each
-     * pair we join the two games with each other.
+     * pair we join the two games with each other.  Both game sets are
+     * snapshotted into arrays, so the product can be handed out as
+     * two-dimensional tiles rather than through a sequential iterator.
      */
-    typedef PairIteratorStl<GameVoidPtrMap::const_iterator, GameVoidPtrMap::const_iterator> PairIt;
-    PairIt pit(left_inmap->begin(), left_inmap->end(),
-	       right_inmap->begin(), right_inmap->end());
-    PairIt pitend(left_inmap->end(), right_inmap->end());
+    typedef typename ApplyGameJoin<Solver>::game_value_type GameValue;
+    std::vector<GameValue> left_games, right_games;
+    internal::snapshot_games(left_inmap, left_games);
+    internal::snapshot_games(right_inmap, right_games);
     DPRINTLN("Start iterating over sets");
 #ifdef HAVE_TBB
-    tbb::parallel_do(pit, pitend, lightweight_apply(&apply));
+    typedef internal::ApplyJoinTile<ApplyGameJoin<Solver> > Tile;
+    tbb::parallel_for(tbb::blocked_range2d<size_t>(0, left_games.size(),
+                                                   0, right_games.size()),
+                      Tile(&apply, &left_games, &right_games));
 #else
-    std::for_each(pit, pitend, lightweight_apply(&apply));
+    for (size_t i = 0; i < left_games.size(); ++i)
+        for (size_t j = 0; j < right_games.size(); ++j)
+            apply(std::make_pair(left_games[i], right_games[j]));
 #endif
     _solver->log_games_completed(apply.count());
 }
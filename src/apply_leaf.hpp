@@ -40,7 +40,7 @@ void ApplyLeaf<Solver>::operator()() {
     boost::scoped_ptr<const Assignment_f> alpha(_solver->base_alpha()->clone());
     for (unsigned int i = 0; i < _solver->n_terminals(); i++) {
         const ConstantSymbol *sym = _solver->terminal_symbol(i);
-        alpha.reset(AssignmentFlyFactory::make(new ObjAssignment(alpha.get(), sym, NULL)));
+        alpha.reset(AssignmentFlyFactory::make(ObjAssignment::make(alpha.get(), sym, NULL)));
     }
     _solver->alpha(_node, alpha.get());
 
@@ -49,7 +49,7 @@ void ApplyLeaf<Solver>::operator()() {
 	const UnarySymbol* sym = _solver->free_unary_symbol(i);
 	const SetMove* smove = moves_pool.pool(new SetMove(sym));
 	DPRINTLN("Assign '" << sym->identifier() << "' to: " << smove->toString());
-        alpha.reset(AssignmentFlyFactory::make(new SetAssignment(alpha.get(), sym, smove)));
+        alpha.reset(AssignmentFlyFactory::make(SetAssignment::make(alpha.get(), sym, smove)));
     }
     _solver->alpha(_node, alpha.get());
 
@@ -0,0 +1,76 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "arena.h"
+
+#include <cassert>
+
+namespace sequoia {
+
+namespace {
+// Most tables are small, so start with small chunks and grow
+// geometrically up to the maximum chunk size.
+const size_t ARENA_INITIAL_CHUNK = 1 << 10;
+const size_t ARENA_MAX_CHUNK = 1 << 20;
+}
+
+Arena::Arena()
+: _current(NULL), _end(NULL), _chunk_size(ARENA_INITIAL_CHUNK), _allocated(0) { }
+
+Arena::~Arena() {
+    for (unsigned int i = 0; i < _chunks.size(); i++)
+        delete[] _chunks[i];
+}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    assert(align != 0 && (align & (align - 1)) == 0);
+#ifdef HAVE_TBB
+    tbb::spin_mutex::scoped_lock lock(_mutex);
+#endif
+    char* p = reinterpret_cast<char*>(
+        (reinterpret_cast<size_t>(_current) + align - 1) & ~(align - 1));
+    if (_current == NULL || p + bytes > _end)
+        return allocate_chunk(bytes + align - 1);
+    _current = p + bytes;
+    return p;
+}
+
+void* Arena::allocate_chunk(size_t bytes) {
+    // large blocks (e.g., bucket arrays) get a chunk of their own, so we
+    // do not waste the remainder of the current chunk
+    if (bytes > _chunk_size / 4) {
+        char* chunk = new char[bytes];
+        _chunks.push_back(chunk);
+        _allocated += bytes;
+        // new[] returns memory suitably aligned for any type
+        return chunk;
+    }
+    char* chunk = new char[_chunk_size];
+    _chunks.push_back(chunk);
+    _allocated += _chunk_size;
+    _current = chunk + bytes;
+    _end = chunk + _chunk_size;
+    if (_chunk_size < ARENA_MAX_CHUNK)
+        _chunk_size *= 2;
+    return chunk;
+}
+
+} // namespace
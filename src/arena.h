@@ -0,0 +1,80 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_ARENA_H
+#define	SEQUOIA_ARENA_H
+
+#include "common.h"
+
+#ifdef HAVE_TBB
+#include <tbb/spin_mutex.h>
+#endif
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace sequoia {
+
+/**
+ * A monotonic memory arena.  Memory is handed out from large chunks
+ * by bumping a pointer and only released as a whole when the arena is
+ * destroyed; deallocating single objects is a no-op.  Destructors of
+ * objects placed in the arena are not run automatically.
+ *
+ * Allocation is thread safe when built with TBB, where the tables
+ * are filled concurrently.
+ */
+class Arena {
+public:
+    Arena();
+    ~Arena();
+
+    /**
+     * @param bytes size of the requested block
+     * @param align alignment of the block, must be a power of two
+     */
+    void* allocate(size_t bytes, size_t align = sizeof(void*));
+
+    /**
+     * Total number of bytes requested from the system.
+     */
+    size_t allocated() const { return _allocated; }
+
+private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    void* allocate_chunk(size_t bytes);
+
+    std::vector<char*> _chunks;
+    char* _current;
+    char* _end;
+    size_t _chunk_size;
+    size_t _allocated;
+#ifdef HAVE_TBB
+    tbb::spin_mutex _mutex;
+#endif
+};
+
+} // namespace
+
+#endif	/* SEQUOIA_ARENA_H */
@@ -27,6 +27,62 @@
 
 namespace sequoia {
 
+namespace {
+
+/**
+ * The undetermined games of the atomic formulas.  Each is built and
+ * interned on first use, afterwards only a reference is added.  The
+ * table is filled without locking, open addressing with a
+ * compare-and-swap on the formula of a slot.
+ */
+class UndeterminedGames {
+public:
+    UndeterminedGames() {
+	for (unsigned int i = 0; i < SIZE; i++) {
+	    _slots[i].formula = NULL;
+	    _slots[i].game = NULL;
+	}
+    }
+    const MCGame_f* get(const Formula* formula) {
+	size_t i = ((reinterpret_cast<size_t>(formula) * GOLDEN) >> 32) & (SIZE - 1);
+	for (unsigned int n = 0; n < SIZE; n++, i = (i + 1) & (SIZE - 1)) {
+	    Slot& slot = _slots[i];
+	    const Formula* f = __atomic_load_n(&slot.formula, __ATOMIC_ACQUIRE);
+	    if (f == NULL) {
+		if (!__atomic_compare_exchange_n(&slot.formula, &f, formula, false,
+						 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+		    && f != formula)
+		    continue;
+		if (f == NULL) { // claimed the slot
+		    const MCGame_f* game = make(formula);
+		    __atomic_store_n(&slot.game, game->clone(), __ATOMIC_RELEASE);
+		    return game;
+		}
+	    }
+	    if (f != formula)
+		continue;
+	    const MCGame_f* game = __atomic_load_n(&slot.game, __ATOMIC_ACQUIRE);
+	    // otherwise, another thread is just building it
+	    return game != NULL ? game->clone() : make(formula);
+	}
+	return make(formula); // table full
+    }
+private:
+    static const size_t GOLDEN = static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+    // more atomic subformulas are built each time
+    static const unsigned int SIZE = 1024;
+    struct Slot {
+	const Formula* formula;
+	const MCGame_f* game;
+    };
+    static const MCGame_f* make(const Formula* formula) {
+	return MCGameFlyFactory::make(new AtomarUndetGame(formula));
+    }
+    Slot _slots[SIZE];
+} undetermined_games;
+
+} // namespace
+
 void AtomarGameFactory::visit(const UnivSetQFormula* f) { assert(false); }
 void AtomarGameFactory::visit(const ExistSetQFormula* f) { assert(false); }
 void AtomarGameFactory::visit(const UnivObjQFormula* f) { assert(false); }
@@ -49,26 +105,17 @@ void AtomarGameFactory::visit(const AtomarFormulaMember * f) {
     assert(smove != NULL);
 
     if (pmove == NULL) {
-        AtomarUndetGame* returngame = new AtomarUndetGame(f);
-        DEBUG(returngame->level(_level));
-        _game = MCGameFlyFactory::make(returngame);
+        result(f, MCGame::UNDETERMINED);
         return;
     }
 
     assert(pmove->nesting_depth() != smove->nesting_depth());
-    if (pmove->nesting_depth() > smove->nesting_depth()) {
-        if (pmove->test_label(smove->symbol())) {
-            _game = determined.get(MCGame::VERIFIER);
-        } else {
-            _game = determined.get(MCGame::FALSIFIER);
-        }
-    } else {
-        if (smove->test(pmove->symbol())) {
-            _game = determined.get(MCGame::VERIFIER);
-        } else {
-            _game = determined.get(MCGame::FALSIFIER);
-        }
-    }
+    bool member;
+    if (pmove->nesting_depth() > smove->nesting_depth())
+        member = pmove->test_label(smove->symbol());
+    else
+        member = smove->test(pmove->symbol());
+    result(f, member ? MCGame::VERIFIER : MCGame::FALSIFIER);
 }
 
 void AtomarGameFactory::visit(const AtomarFormulaAdj * f) {
@@ -86,47 +133,30 @@ void AtomarGameFactory::visit(const AtomarFormulaAdj * f) {
 
     // both are not set, so game remains undetermined
     if (xmove == NULL && ymove == NULL) {
-        AtomarUndetGame* returngame = new AtomarUndetGame(f);
-        DEBUG(returngame->level(_level));
-        _game = MCGameFlyFactory::make(returngame);;
+        result(f, MCGame::UNDETERMINED);
         return;
     }
     // if both are set, we lookup the adjacency in the vertex with
     // the higher nesting depth
     if (xmove != NULL && ymove != NULL) {
-        if (xmove->nesting_depth() > ymove->nesting_depth()) {
-            if (xmove->test_edge(ymove->nesting_depth())) {
-                _game = determined.get(MCGame::VERIFIER);
-                return;
-            } else {
-                _game = determined.get(MCGame::FALSIFIER);
-                return;
-            }
-        } else {
-            if (ymove->test_edge(xmove->nesting_depth())) {
-                _game = determined.get(MCGame::VERIFIER);
-                return;
-            } else {
-                _game = determined.get(MCGame::FALSIFIER);
-                return;
-            }
-        }
+        bool adjacent;
+        if (xmove->nesting_depth() > ymove->nesting_depth())
+            adjacent = xmove->test_edge(ymove->nesting_depth());
+        else
+            adjacent = ymove->test_edge(xmove->nesting_depth());
+        result(f, adjacent ? MCGame::VERIFIER : MCGame::FALSIFIER);
+        return;
     }
     assert(xmove == NULL || ymove == NULL);
 
     // The bag is a separator.  Thus if none of them is a terminal, they are
     // not adjacent.
-    if(xmove != NULL && !xmove->terminal()) {
-        _game = determined.get(MCGame::FALSIFIER);
-        return;
-    }
-    if(ymove != NULL && !ymove->terminal()) {
-        _game = determined.get(MCGame::FALSIFIER);
+    if ((xmove != NULL && !xmove->terminal())
+        || (ymove != NULL && !ymove->terminal())) {
+        result(f, MCGame::FALSIFIER);
         return;
     }
-    AtomarUndetGame* returngame = new AtomarUndetGame(f);
-    DEBUG(returngame->level(_level));
-    _game = MCGameFlyFactory::make(returngame);
+    result(f, MCGame::UNDETERMINED);
 }
 
 void AtomarGameFactory::visit(const AtomarFormulaEquals* f) {
@@ -143,16 +173,14 @@ void AtomarGameFactory::visit(const AtomarFormulaEquals* f) {
     const PointMove *ymove = _alpha->get()->get(y);
 
     if (xmove != NULL && xmove == ymove) {
-    	_game = determined.get(MCGame::VERIFIER);
+    	result(f, MCGame::VERIFIER);
 	return;
     }
     if ((xmove == NULL && ymove != NULL) || (xmove != NULL && ymove == NULL)) {
-    	_game = determined.get(MCGame::FALSIFIER);
+    	result(f, MCGame::FALSIFIER);
 	return;
     }
-    AtomarUndetGame* returngame = new AtomarUndetGame(f);
-    DEBUG(returngame->level(_level));
-    _game = MCGameFlyFactory::make(returngame);
+    result(f, MCGame::UNDETERMINED);
 }
 
 void AtomarGameFactory::visit(const NegatedFormula * f) {
@@ -164,19 +192,20 @@ void AtomarGameFactory::visit(const NegatedFormula * f) {
     AtomarGameFactory factory(_alpha);
     DEBUG(factory.level(_level+1));
     f->subformula()->accept(&factory);
-    const MCGame_f* sub = factory.get();
-
-    if (sub->get()->outcome() == MCGame::FALSIFIER) {
-	_game = determined.get(MCGame::opponent<MCGame::FALSIFIER>::value);
-    } else if (sub->get()->outcome() == MCGame::VERIFIER) {
-	_game = determined.get(MCGame::opponent<MCGame::VERIFIER>::value);
-    } if (sub->get()->outcome() == MCGame::UNDETERMINED) {
-        // ceate a new game with the correct formula set.
-        AtomarUndetGame* returngame = new AtomarUndetGame(f);
-        DEBUG(returngame->level(_level));
-        _game = MCGameFlyFactory::make(returngame);
-    }
-    delete sub;
+
+    if (factory.outcome() == MCGame::FALSIFIER)
+	result(f, MCGame::opponent<MCGame::FALSIFIER>::value);
+    else if (factory.outcome() == MCGame::VERIFIER)
+	result(f, MCGame::opponent<MCGame::VERIFIER>::value);
+    else // the game with the correct formula set
+	result(f, MCGame::UNDETERMINED);
+}
+
+const MCGame_f* AtomarGameFactory::get() const {
+    assert(_formula != NULL);
+    if (_outcome != MCGame::UNDETERMINED)
+	return determined.get(_outcome);
+    return undetermined_games.get(_formula);
 }
 
 } // namespace
@@ -27,10 +27,17 @@
 
 namespace sequoia {
 
+/**
+ * Evaluates an atomic (or negated atomic) formula under an assignment.
+ * Only the outcome is computed while visiting the formula, get() then
+ * returns one of the shared games: the determined games or the
+ * undetermined game of the formula.  The latter does not depend on the
+ * assignment, so it is built once per formula and looked up afterwards.
+ */
 class AtomarGameFactory : public FormulaVisitor {
 public:
     AtomarGameFactory(const Assignment_f* alpha) :
-        _alpha(alpha) {
+        _alpha(alpha), _formula(NULL), _outcome(MCGame::UNDETERMINED) {
             DEBUG(_level = 0);
     }
     void visit(const UnivSetQFormula* f);
@@ -45,11 +52,17 @@ public:
     void visit(const AtomarFormulaEquals* f);
     void visit(const NegatedFormula* f);
 
-    const MCGame_f* get() { return _game; }
+    MCGame::Player outcome() const { return _outcome; }
+    const MCGame_f* get() const;
     DEBUG(void level(int level) { _level = level; })
 private:
+    void result(const Formula* f, MCGame::Player outcome) {
+        _formula = f;
+        _outcome = outcome;
+    }
     const Assignment_f* _alpha;
-    const MCGame_f* _game;
+    const Formula* _formula;
+    MCGame::Player _outcome;
     DEBUG(int _level;)
 };
 
@@ -22,75 +22,201 @@
 #ifndef SEQUOIA_CACHE_H
 #define SEQUOIA_CACHE_H
 
+#include "cache_admission.h"
+#include "cache_pin.h"
+#include "cache_statistics.h"
 #include "common.h"
 #include "hashing.h"
 #include "list.h"
 #include "unordered_defs.h"
 
+#include <algorithm>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #ifdef HAVE_TBB
-#include <tbb/enumerable_thread_specific.h>
+#include <tbb/atomic.h>
+#include <tbb/spin_rw_mutex.h>
+#else
+#include <atomic>
+#include <mutex>
 #endif
 
 namespace sequoia {
 
+/**
+ * Approximate number of bytes occupied by a cached key or value, for
+ * accounting against the caches' memory budget.  Overload this for
+ * types that own variable-sized data.  Pooled flyweight objects are
+ * shared with the tables and other entries and thus not attributed to
+ * the cache, only their handles are.
+ */
+template <typename T> inline size_t cache_bytes(const T& obj) {
+    return sizeof(obj);
+}
+
 namespace internal {
+
+#ifdef HAVE_TBB
+typedef tbb::atomic<size_t> CacheCounter;
+#else
+typedef std::atomic<size_t> CacheCounter;
+#endif
+
+/**
+ * The counters of CacheStatistics, updated concurrently.
+ */
+struct CacheEventCounters {
+    CacheEventCounters() {
+        lookups = 0;
+        hits = 0;
+        stores = 0;
+        evictions = 0;
+        duplicates = 0;
+        rejected = 0;
+    }
+    CacheStatistics::Counters snapshot() const {
+        CacheStatistics::Counters c;
+        c.lookups = lookups;
+        c.hits = hits;
+        c.stores = stores;
+        c.evictions = evictions;
+        c.duplicates = duplicates;
+        c.rejected = rejected;
+        return c;
+    }
+    CacheCounter lookups;
+    CacheCounter hits;
+    CacheCounter stores;
+    CacheCounter evictions;
+    CacheCounter duplicates;
+    CacheCounter rejected;
+};
+
 /**
- * A LRU Cache class for lookups of type Key to Values of type Value.
+ * A Cache class for lookups of type Key to Values of type Value.
  * Key and Value are the plain object types, however we only handle
  * pointers to the respective objects here.  
- * Value class must be clone()-able.
+ * Lookups return a CachePin to the stored value instead of a copy.
+ *
+ * Entries are evicted either in LRU order, which requires moving an
+ * entry to the end of a list on every hit, or by the CLOCK (second
+ * chance) approximation of LRU, where a hit only sets the entry's
+ * reference bit.  With CLOCK, lookups do not modify the cache's
+ * structure and may run concurrently.
+ * Not thread-safe otherwise, see Cache for the synchronized, sharded
+ * version.
+ *
+ * The cache is limited by the approximate number of bytes of its
+ * entries (see cache_bytes()), not by their number.  The keys of
+ * recently evicted entries are remembered (as hash values only) and
+ * lookups missing the cache but hitting one of these "ghosts" are
+ * counted: these would have been hits if the cache were larger, which
+ * tells Cache users how much the cache would profit from more memory.
+ *
+ * If the cache is full, a new entry is only admitted if its key was
+ * requested at least as often recently as the key of the entry it would
+ * replace (TinyLFU), such that rarely used entries do not push out the
+ * frequently used ones.  The frequencies are estimated by a sketch
+ * shared by all shards of a Cache.
+ *
+ * Lookups, hits, stores, evictions, and duplicate stores are counted
+ * separately for the heights of the formulas the entries belong to,
+ * see CacheStatistics.
  */
 template <typename Key, typename Value,
         typename Hash, typename Equals = std::equal_to<Key> >
 class CacheImpl {
+    struct Entry;
+    typedef List<Entry> ListImpl;
+    typedef typename ListImpl::Handle ListHandle;
+#ifdef HAVE_TBB
+    typedef tbb::atomic<bool> Flag;
+#else
+    typedef std::atomic<bool> Flag;
+#endif
+    struct Entry : public CacheEntryBase<Value> {
+        Entry(const Key* k, const Value* v, unsigned int h)
+        : CacheEntryBase<Value>(v), key(k), handle(NULL),
+          bytes(entry_bytes(k, v)), height(h) {
+            referenced = false;
+        }
+        virtual ~Entry() { delete key; }
+        const Key* key;
+        ListHandle handle;       // position in the LRU list
+        mutable Flag referenced; // CLOCK reference bit
+        const size_t bytes;      // accounted size of the entry
+        const unsigned int height; // formula height, for the statistics
+    };
 public:
-    CacheImpl(const size_t *max_size) : _max_size(max_size), _size(0UL) { }
-    // do not create a full copy, instead create a new empty cache
-    CacheImpl(const CacheImpl &other)
-    : _list(), _cache(), _max_size(other._max_size), _size(0UL) { }
+    CacheImpl(const CacheCounter *max_bytes, FrequencySketch *sketch)
+    : _size(0UL), _max_bytes(max_bytes), _sketch(sketch),
+      _policy(CACHE_EVICT_LRU), _hand(0) {
+        _bytes = 0;
+        _ghost_hits = 0;
+    }
     typedef Value value_type;
-    typedef typename std::pair<const Key*, const Value*> KeyValuePair;
 
     /**
      * Lookup the value stored for the given key.
-     * Returns a cloned() instance.
-     * @return the value found for key, or NULL if non-existent
+     * @param height height of the key's formula, for the statistics
+     * @return a pin of the value found for key, empty if non-existent
      */
-    const Value* lookup(const Key* key) {
+    CachePin<Value> lookup(const Key* key, unsigned int height) {
 #if USE_CACHE
         //DPRINTLN("[Cache<" << typeid(K).name() << "> lookup: " << key);
+        CacheEventCounters& counters = stats(height);
+        counters.lookups++;
+        size_t hash = Hash()(*key);
+        _sketch->increment(hash);
         typename ContainerImpl::const_iterator cit = _cache.find(key);
         if (cit == _cache.end()) {
             //DPRINTLN("lookup failed");
-            return NULL;
+            if (!_ghosts.empty() && _ghosts.count(hash) != 0)
+                _ghost_hits++;
+            return CachePin<Value>();
         }
         //DPRINTLN("lookup sucessful: " << cit->second);
-        const ListHandle &it = cit->second;
-	// move element to end of list (LRU)
-        _list.move_back(it);
-        const KeyValuePair *entry = it->value();
-	return entry->second->clone();
+        const Entry *entry = cit->second;
+        if (_policy == CACHE_EVICT_LRU) {
+	    // move element to end of list (LRU)
+            _list.move_back(entry->handle);
+        } else {
+            entry->referenced = true;
+        }
+        entry->acquire();
+        counters.hits++;
+	return CachePin<Value>(entry);
 #else
-        return NULL;
+        return CachePin<Value>();
 #endif
     }
-    const Value* lookup(const Key& key) { return lookup(&key); }
+    CachePin<Value> lookup(const Key& key, unsigned int height) {
+        return lookup(&key, height);
+    }
     /**
      * Try to store the value value at position key. 
      * @param key the key for the store
      * @param value the value to store
+     * @param height height of the key's formula, for the statistics
      * @return true iff the entry was new
      */
-    bool store(const Key* key, const Value* value) {
+    bool store(const Key* key, const Value* value, unsigned int height) {
 #if USE_CACHE
-	if (*_max_size == 0) {
+	if (*_max_bytes == 0) {
 	    delete key;
 	    delete value;
 	    return false;
 	}
-        bool res = this->store_impl(key, value);
+        if (!admit(key, value)) {
+	    delete key;
+	    delete value;
+            stats(height).rejected++;
+	    return false;
+        }
+        bool res = this->store_impl(key, value, height);
 	maybe_purge();
 	return res;
 #else
@@ -98,109 +224,325 @@ public:
 #endif
     }
 
+    CacheEvictionPolicy eviction_policy() const { return _policy; }
+    /**
+     * Change the eviction policy, keeping the entries.
+     */
+    void eviction_policy(CacheEvictionPolicy policy) {
+        if (policy == _policy)
+            return;
+        if (policy == CACHE_EVICT_CLOCK) {
+            while (!_list.empty()) {
+                Entry* entry = const_cast<Entry*>(_list.pop_front());
+                entry->handle = NULL;
+                entry->referenced = false;
+                _ring.push_back(entry);
+            }
+        } else {
+            for (unsigned int i = 0; i < _ring.size(); i++)
+                _ring[i]->handle = _list.push_back(_ring[i]);
+            _ring.clear();
+            _hand = 0;
+        }
+        _policy = policy;
+    }
+
+    /**
+     * Number of entries resp. their accounted bytes.
+     */
+    size_t size() const { return _size; }
+    size_t bytes() const { return _bytes; }
+    /**
+     * Return the number of lookups that hit a recently evicted entry since
+     * the last call.
+     */
+    size_t take_ghost_hits() {
+        size_t hits = _ghost_hits;
+        _ghost_hits -= hits;
+        return hits;
+    }
+    /**
+     * Add the counters to statistics.  Not synchronized with concurrent
+     * updates, so the counters may be slightly inconsistent.
+     */
+    void add_statistics(CacheStatistics& statistics) const {
+        for (unsigned int i = 0; i < STATS_HEIGHTS; i++)
+            statistics.add(i, _stats[i].snapshot());
+    }
+
 private:
 
-    bool store_impl(const Key* key, const Value* value) {
+    // formulas of larger heights are counted with the largest one, which
+    // the statistics print as such
+    static const unsigned int STATS_HEIGHTS = CacheStatistics::MAX_HEIGHT + 1;
+
+    CacheEventCounters& stats(unsigned int height) {
+        return _stats[std::min(height, STATS_HEIGHTS - 1)];
+    }
+
+    /**
+     * Whether to store the entry, see the TinyLFU description above.
+     * The victim is the next entry to be evicted (LRU) resp. the entry
+     * under the hand (CLOCK).
+     */
+    bool admit(const Key* key, const Value* value) const {
+        if (_size == 0 || _bytes + entry_bytes(key, value) <= *_max_bytes)
+            return true;
+        const Entry* victim;
+        if (_policy == CACHE_EVICT_LRU)
+            victim = _list.front();
+        else
+            victim = _ring[_hand < _ring.size() ? _hand : 0];
+        Hash h;
+        return _sketch->estimate(h(*key)) >= _sketch->estimate(h(*victim->key));
+    }
+
+    bool store_impl(const Key* key, const Value* value, unsigned int height) {
 #if USE_CACHE
         //DPRINTLN("[Cache<" << typeid(K).name() << "> store: " << key << " => " << value);
-        // first insert the entry to the list to obtain a handle
-        const KeyValuePair *entry = new KeyValuePair(key, value);
-        ListHandle it = _list.push_back(entry);
-        // now insert the key and the iterator into the hash map
-        CacheValueType hashentry(key, it);
-        std::pair<CacheIterator, bool> res = _cache.insert(hashentry);
-        if (res.second) { // new entry
-            _size++;
-	    return true;
+        Entry *entry = new Entry(key, value, height);
+        std::pair<CacheIterator, bool> res = _cache.insert(CacheValueType(key, entry));
+        if (!res.second) {
+            // duplicated entry, free the associated pointers
+            entry->release();
+            stats(height).duplicates++;
+            return false;
         }
-        // otherwise, we need to remove the duplicated entry from the
-	// list and free the associated pointers
-        _list.erase(it);
-        delete entry->first;
-        delete entry->second;
-	delete entry;
-#endif // USE_CACHE
+        if (_policy == CACHE_EVICT_LRU) {
+            entry->handle = _list.push_back(entry);
+        } else {
+            // the hand may be right at the new entry, give it a chance
+            // to be used before it is evicted
+            entry->referenced = true;
+            _ring.push_back(entry);
+        }
+        _size++;
+        _bytes += entry->bytes;
+        stats(height).stores++;
+	return true;
+#else
         return false;
+#endif // USE_CACHE
     }
 
     void maybe_purge() {
-        if (_size <= *_max_size) return;
-	size_t topurge = _size - *_max_size;
-	for (unsigned int i = 0; i < topurge; i++) {
-            const KeyValuePair* kvp = _list.pop_front();
-            _cache.erase(kvp->first);
-	    delete kvp->first;
-	    delete kvp->second;
-	    delete kvp;
-	    _size--;
+	while (_bytes > *_max_bytes && _size > 0) {
+            if (_policy == CACHE_EVICT_LRU) {
+                evict(_list.pop_front());
+            } else {
+                // replace the victim by the newest entry, the hand
+                // moves on to the next entry
+                size_t victim = clock_victim();
+                evict(_ring[victim]);
+                _ring[victim] = _ring.back();
+                _ring.pop_back();
+                _hand = victim + 1;
+            }
 	}
-	assert(_size <= *_max_size); // catch bug if _purge_size = 0
     }
 
-    typedef List<KeyValuePair> ListImpl;
-    typedef typename ListImpl::Handle ListHandle;
+    /**
+     * Advance the clock hand to the first entry not referenced since
+     * the hand passed it the last time, clearing the reference bits
+     * on the way.
+     * @return the position of this entry in the ring
+     */
+    size_t clock_victim() {
+        assert(!_ring.empty());
+        for (;;) {
+            if (_hand >= _ring.size())
+                _hand = 0;
+            Entry* entry = _ring[_hand];
+            if (!entry->referenced)
+                return _hand;
+            entry->referenced = false;
+            _hand++;
+        }
+    }
+
+    /**
+     * Remove entry from the hash map and drop the cache's reference.
+     * The caller removes it from the list or ring.
+     */
+    void evict(const Entry* entry) {
+        remember(Hash()(*entry->key));
+        _cache.erase(entry->key);
+        _size--;
+        _bytes -= entry->bytes;
+        stats(entry->height).evictions++;
+        entry->release();
+    }
+
+    /**
+     * Remember the hash of an evicted key.  We keep about as many ghosts
+     * as there are entries, i.e., we count the hits a cache of twice
+     * the size would have had in addition.
+     */
+    void remember(size_t hash) {
+        if (_ghosts.insert(hash).second)
+            _ghost_queue.push_back(hash);
+        while (_ghost_queue.size() > _size) {
+            _ghosts.erase(_ghost_queue.front());
+            _ghost_queue.pop_front();
+        }
+    }
+
+    /**
+     * Bookkeeping overhead of an entry: the entry itself, the hash map
+     * node, and the list node resp. ring slot.
+     */
+    static size_t entry_overhead() {
+        return sizeof(Entry) + 4 * sizeof(void*) + 3 * sizeof(void*);
+    }
+    static size_t entry_bytes(const Key* key, const Value* value) {
+        return entry_overhead() + cache_bytes(*key) + cache_bytes(*value);
+    }
+
     typedef typename std::unordered_map<
 	const Key*,
-	ListHandle,
+	Entry*,
 	ptr_deep_hasher<Key, Hash>,
 	ptr_deep_equals<const Key *>
     > ContainerImpl;
     typedef typename ContainerImpl::value_type CacheValueType;
     typedef typename ContainerImpl::iterator CacheIterator;
 
-    ListImpl _list;
     ContainerImpl _cache;
     size_t _size;
-    const size_t *_max_size;
+    CacheCounter _bytes;
+    const CacheCounter *_max_bytes;
+    FrequencySketch *_sketch;
+    CacheEvictionPolicy _policy;
+    // LRU: entries in order of their last use, least recent first
+    ListImpl _list;
+    // CLOCK: entries in a circular buffer with the current hand position
+    std::vector<Entry*> _ring;
+    size_t _hand;
+    // hashes of recently evicted keys, oldest first
+    std::unordered_set<size_t> _ghosts;
+    std::deque<size_t> _ghost_queue;
+    CacheCounter _ghost_hits;
+    CacheEventCounters _stats[STATS_HEIGHTS];
 };
 
 } // internal
 
+/**
+ * A cache shared by all threads.  The entries are partitioned by their
+ * key's hash into 2^CACHE_SHARD_BITS shards, each of which is a
+ * CacheImpl protected by its own lock, such that threads rarely contend
+ * for the same lock.  The memory budget is split evenly among the shards.
+ * With CLOCK eviction, lookups only take the lock shared (TBB only).
+ */
 template <typename Key, typename Value,
           typename Hash, typename Equals = std::equal_to<Key> >
 class Cache {
     typedef internal::CacheImpl<Key, Value, Hash, Equals> CacheImpl;
 #ifdef HAVE_TBB
-    typedef tbb::enumerable_thread_specific<CacheImpl> ImplWrapper;
-#endif
-public:
-    Cache<Key, Value, Hash, Equals>()
-    : _max_size(CACHE_DEFAULT_SIZE),
-#ifdef HAVE_TBB
-      _impl(CacheImpl(&_max_size))
+    typedef tbb::spin_rw_mutex Mutex;
 #else
-      _impl(&_max_size)
+    typedef std::mutex Mutex;
 #endif
-    { }
-    const Value* lookup(const Key* key) {
+    struct Shard {
+        Shard(const internal::CacheCounter *max_bytes, FrequencySketch *sketch)
+        : impl(max_bytes, sketch) { }
+        CacheImpl impl;
+        Mutex mutex;
+    };
+    static const unsigned int NUM_SHARDS = 1U << CACHE_SHARD_BITS;
+public:
+    Cache<Key, Value, Hash, Equals>() : _policy(CACHE_EVICT_LRU) {
+        // the forget, introduce, and join caches start with equal shares
+        resize(CACHE_DEFAULT_BYTES / 3);
+        for (unsigned int i = 0; i < NUM_SHARDS; i++)
+            _shards[i] = new Shard(&_shard_max_bytes, &_sketch);
+    }
+    ~Cache<Key, Value, Hash, Equals>() {
+        for (unsigned int i = 0; i < NUM_SHARDS; i++)
+            delete _shards[i];
+    }
+    CachePin<Value> lookup(const Key* key, unsigned int height) {
+        Shard& shard = shard_of(key);
 #ifdef HAVE_TBB
-        typename ImplWrapper::reference mine = _impl.local();
-	return mine.lookup(key);
+        // LRU lookups reorder the list and need exclusive access
+        Mutex::scoped_lock lock(shard.mutex, _policy == CACHE_EVICT_LRU);
 #else
-	return _impl.lookup(key);
+        std::lock_guard<Mutex> lock(shard.mutex);
 #endif
+	return shard.impl.lookup(key, height);
     }
-    const Value* lookup(const Key &key) {
-	return lookup(&key);
+    CachePin<Value> lookup(const Key &key, unsigned int height) {
+	return lookup(&key, height);
     }
-    void store(const Key* key, const Value *value) {
+    void store(const Key* key, const Value *value, unsigned int height) {
+        Shard& shard = shard_of(key);
 #ifdef HAVE_TBB
-        typename ImplWrapper::reference mine = _impl.local();
-	mine.store(key, value);
+        Mutex::scoped_lock lock(shard.mutex, true);
 #else
-        _impl.store(key, value);
+        std::lock_guard<Mutex> lock(shard.mutex);
 #endif
+        shard.impl.store(key, value, height);
+    }
+    /**
+     * Limit the cache to (approximately) max_bytes bytes.  May be called
+     * while the cache is in use, a shard shrinks on its next store.
+     */
+    void resize(size_t max_bytes) {
+        _max_bytes = max_bytes;
+        _shard_max_bytes = (max_bytes + NUM_SHARDS - 1) / NUM_SHARDS;
+    }
+    size_t max_bytes() const { return _max_bytes; }
+    /**
+     * Accounted bytes of all entries, not synchronized with concurrent
+     * stores.
+     */
+    size_t bytes() const {
+        size_t sum = 0;
+        for (unsigned int i = 0; i < NUM_SHARDS; i++)
+            sum += _shards[i]->impl.bytes();
+        return sum;
+    }
+    /**
+     * Return the number of lookups since the last call that missed the
+     * cache, but would have hit a cache of twice the size.
+     */
+    size_t take_ghost_hits() {
+        size_t sum = 0;
+        for (unsigned int i = 0; i < NUM_SHARDS; i++)
+            sum += _shards[i]->impl.take_ghost_hits();
+        return sum;
     }
-    void resize(size_t size) {
-        _max_size = size;
+    CacheStatistics statistics() const {
+        CacheStatistics statistics;
+        for (unsigned int i = 0; i < NUM_SHARDS; i++)
+            _shards[i]->impl.add_statistics(statistics);
+        return statistics;
+    }
+    CacheEvictionPolicy eviction_policy() const { return _policy; }
+    /**
+     * Not thread-safe, call only while the cache is not in use.
+     */
+    void eviction_policy(CacheEvictionPolicy policy) {
+        _policy = policy;
+        for (unsigned int i = 0; i < NUM_SHARDS; i++)
+            _shards[i]->impl.eviction_policy(policy);
     }
 private:
-    size_t _max_size;
-#ifdef HAVE_TBB
-    ImplWrapper _impl;
-#else
-    CacheImpl _impl;
-#endif
+    Cache(const Cache&);
+    Cache& operator=(const Cache&);
+
+    Shard& shard_of(const Key* key) {
+        Hash h;
+        size_t mixed = h(*key) * static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+        // the high-order bits, CacheImpl's hash map uses the low-order ones
+        return *_shards[mixed >> (sizeof(size_t) * CHAR_BIT - CACHE_SHARD_BITS)];
+    }
+
+    internal::CacheCounter _max_bytes;
+    internal::CacheCounter _shard_max_bytes;
+    CacheEvictionPolicy _policy;
+    FrequencySketch _sketch;
+    Shard* _shards[NUM_SHARDS];
 };
 
 } // namespace
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ * 
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "cache_admission.h"
+#include "logic/formula.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+namespace sequoia {
+
+namespace {
+const size_t GOLDEN = static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+// bypassed formulas still use the cache for 1/2^SAMPLE_BITS of their keys
+const unsigned int SAMPLE_BITS = 4;
+// a hit on an entry of height h saves about 2^h times the costs of a
+// lookup and store, cap this to avoid overflows
+const unsigned int MAX_COST_BITS = 16;
+}
+
+FrequencySketch::FrequencySketch(unsigned int log_width)
+: _log_width(log_width), _counters(new uint8_t[DEPTH << log_width]()),
+  _sample_size(10UL << log_width) {
+    assert(DEPTH * log_width <= sizeof(size_t) * CHAR_BIT);
+    _additions = 0;
+}
+
+FrequencySketch::~FrequencySketch() {
+    delete[] _counters;
+}
+
+size_t
+FrequencySketch::index(size_t hash, unsigned int row) const {
+    // the high bits of a multiplicative hash are the well mixed ones
+    size_t h = hash * GOLDEN;
+    size_t slice = h >> (sizeof(size_t) * CHAR_BIT - (row + 1) * _log_width);
+    return (static_cast<size_t>(row) << _log_width)
+	+ (slice & ((static_cast<size_t>(1) << _log_width) - 1));
+}
+
+void
+FrequencySketch::increment(size_t hash) {
+    // conservative update: only increment the minimal counters
+    uint8_t* counters[DEPTH];
+    uint8_t min = MAX_COUNT;
+    for (unsigned int row = 0; row < DEPTH; row++) {
+	counters[row] = _counters + index(hash, row);
+	min = std::min(min, __atomic_load_n(counters[row], __ATOMIC_RELAXED));
+    }
+    if (min == MAX_COUNT)
+	return;
+    for (unsigned int row = 0; row < DEPTH; row++) {
+	if (__atomic_load_n(counters[row], __ATOMIC_RELAXED) == min)
+	    __atomic_store_n(counters[row], min + 1, __ATOMIC_RELAXED);
+    }
+    if (++_additions == _sample_size)
+	age();
+}
+
+unsigned int
+FrequencySketch::estimate(size_t hash) const {
+    uint8_t min = MAX_COUNT;
+    for (unsigned int row = 0; row < DEPTH; row++)
+	min = std::min(min, __atomic_load_n(_counters + index(hash, row),
+					    __ATOMIC_RELAXED));
+    return min;
+}
+
+void
+FrequencySketch::age() {
+    size_t size = DEPTH << _log_width;
+    for (size_t i = 0; i < size; i++) {
+	uint8_t c = __atomic_load_n(_counters + i, __ATOMIC_RELAXED);
+	__atomic_store_n(_counters + i, c >> 1, __ATOMIC_RELAXED);
+    }
+    _additions -= _sample_size / 2;
+}
+
+CacheAdmission::CacheAdmission() {
+    for (unsigned int i = 0; i < MAX_FORMULAS; i++) {
+	_states[i].formula = NULL;
+	_states[i].lookups = 0;
+	_states[i].hits = 0;
+	_states[i].bypass = false;
+    }
+}
+
+CacheAdmission::FormulaState*
+CacheAdmission::state(const Formula* formula) {
+    size_t i = ((reinterpret_cast<size_t>(formula) * GOLDEN) >> 32) & (MAX_FORMULAS - 1);
+    for (unsigned int n = 0; n < MAX_FORMULAS; n++, i = (i + 1) & (MAX_FORMULAS - 1)) {
+	const Formula* f = __atomic_load_n(&_states[i].formula, __ATOMIC_ACQUIRE);
+	if (f == formula)
+	    return &_states[i];
+	if (f != NULL)
+	    continue;
+	const Formula* expected = NULL;
+	if (__atomic_compare_exchange_n(&_states[i].formula, &expected, formula,
+					false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+	    || expected == formula)
+	    return &_states[i];
+    }
+    return NULL;
+}
+
+bool
+CacheAdmission::admits(const Formula* formula, size_t hash) {
+    FormulaState* s = state(formula);
+    if (s == NULL || !s->bypass)
+	return true;
+    // not the high bits, Cache selects the shard by these
+    return (((hash * GOLDEN) >> 32) & ((1U << SAMPLE_BITS) - 1)) == 0;
+}
+
+void
+CacheAdmission::record(const Formula* formula, bool hit) {
+    FormulaState* s = state(formula);
+    if (s == NULL)
+	return;
+    if (hit)
+	s->hits++;
+    if (++s->lookups % CACHE_ADMISSION_WINDOW == 0)
+	evaluate(s);
+}
+
+void
+CacheAdmission::evaluate(FormulaState* state) {
+    size_t hits = state->hits;
+    state->hits -= hits;
+    unsigned int cost_bits = std::min<size_t>(state->formula->height(), MAX_COST_BITS);
+    // bypass if hit rate * recomputation cost < 1
+    state->bypass = (hits << cost_bits) < CACHE_ADMISSION_WINDOW;
+}
+
+} // namespace
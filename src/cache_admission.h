@@ -0,0 +1,131 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ * 
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_CACHE_ADMISSION_H
+#define	SEQUOIA_CACHE_ADMISSION_H
+
+#include "common.h"
+
+#ifdef HAVE_TBB
+#include <tbb/atomic.h>
+#else
+#include <atomic>
+#endif
+
+#include <stdint.h>
+
+namespace sequoia {
+
+class Formula;
+
+/**
+ * A count-min sketch of how often keys were requested recently, as used
+ * by the TinyLFU admission policy.  Each key is mapped to one small
+ * counter in each of four rows, and its frequency is estimated by the
+ * minimum of them.  After a number of increments proportional to the
+ * width, all counters are halved, such that old requests fade out.
+ *
+ * The counters are updated without locking, concurrent increments may
+ * be lost, which does not matter for an estimate.
+ */
+class FrequencySketch {
+public:
+    /**
+     * @param log_width logarithm of the number of counters per row
+     */
+    explicit FrequencySketch(unsigned int log_width = 14);
+    ~FrequencySketch();
+    void increment(size_t hash);
+    unsigned int estimate(size_t hash) const;
+private:
+    FrequencySketch(const FrequencySketch&);
+    FrequencySketch& operator=(const FrequencySketch&);
+
+    static const unsigned int DEPTH = 4;
+    static const uint8_t MAX_COUNT = 15;
+
+    size_t index(size_t hash, unsigned int row) const;
+    void age();
+
+    unsigned int _log_width;
+    uint8_t* _counters;
+    size_t _sample_size;
+#ifdef HAVE_TBB
+    tbb::atomic<size_t> _additions;
+#else
+    std::atomic<size_t> _additions;
+#endif
+};
+
+/**
+ * Learns per formula whether caching its results pays off.  Once a
+ * formula's hit rate over a window of CACHE_ADMISSION_WINDOW lookups is
+ * too low for the cost of recomputing its results, lookups and stores
+ * for it bypass the cache.  The recomputation cost is not measured, we
+ * estimate that it doubles with each level of the formula's height.
+ *
+ * Bypassed formulas still use the cache for a fixed sample of their keys
+ * (by hash value), such that their hit rate keeps being observed and the
+ * decision is revised if the formula becomes worth caching.
+ *
+ * Thread-safe.
+ */
+class CacheAdmission {
+public:
+    CacheAdmission();
+    /**
+     * Whether lookups and stores of the key with the given hash value
+     * for formula should use the cache.
+     */
+    bool admits(const Formula* formula, size_t hash);
+    /**
+     * Record the outcome of an admitted lookup.
+     */
+    void record(const Formula* formula, bool hit);
+private:
+    CacheAdmission(const CacheAdmission&);
+    CacheAdmission& operator=(const CacheAdmission&);
+
+#ifdef HAVE_TBB
+    typedef tbb::atomic<size_t> Counter;
+    typedef tbb::atomic<bool> Flag;
+#else
+    typedef std::atomic<size_t> Counter;
+    typedef std::atomic<bool> Flag;
+#endif
+    struct FormulaState {
+        const Formula* formula;
+        Counter lookups;
+        Counter hits;
+        Flag bypass;
+    };
+    // more subformulas are not tracked and always admitted
+    static const unsigned int MAX_FORMULAS = 1024;
+
+    FormulaState* state(const Formula* formula);
+    void evaluate(FormulaState* state);
+
+    FormulaState _states[MAX_FORMULAS];
+};
+
+} // namespace
+
+#endif	// SEQUOIA_CACHE_ADMISSION_H
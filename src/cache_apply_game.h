@@ -43,11 +43,19 @@ public:
 	return _symbol == other._symbol;
     }
     size_t hash() const {
+        return hash(_formula, &_alpha, &_game, _symbol);
+    }
+    /**
+     * The hash value of the key for these parameters, without creating
+     * the key.
+     */
+    static size_t hash(const Formula *f, const Assignment_f *a, const MCGame_f *g,
+                       const ConstantSymbol *s) {
 	size_t h = hash_init();
-        hash_combine(h, _formula->hash());
-        hash_combine(h, _alpha.get()->hash());
-	hash_combine(h, _game.get()->hash());
-	hash_combine(h, _symbol->hash());
+        hash_combine(h, f->hash());
+        hash_combine(h, flyweight_hash(*a));
+	hash_combine(h, flyweight_hash(*g));
+	hash_combine(h, s->hash());
 	return h;
     }
 private:
@@ -66,37 +74,64 @@ class CacheApplyGame {
     > CacheImpl;
 public:
     /**
-     * Stores the entry. Will internally create clones of all parameters.
+     * Stores the entry, unless the formula bypasses the cache (see
+     * CacheAdmission). Will internally create clones of all parameters.
      * No external cloning required.
+     * @return false if the formula bypasses the cache
      */
-    void
+    bool
     store(const Formula *formula, const Assignment_f *alpha,
           const MCGame_f *game, const ConstantSymbol *sym,
           const Value *result) {
 #if USE_CACHE
+        if (!_admission.admits(formula, CacheApplyGameKey::hash(formula, alpha, game, sym)))
+            return false;
         const CacheApplyGameKey *key = new CacheApplyGameKey(formula, alpha, game, sym);
-	_container.store(key, result->clone());
+	_container.store(key, result->clone(), formula->height());
+        return true;
+#else
+        return false;
 #endif
     }
     /**
-    * Returns an entry or NULL if nonexistent. Entry must be deleted after usage.
+    * Returns a pin of the entry, empty if nonexistent.
     */
-    const Value*
+    CachePin<Value>
     lookup(const Formula *formula, const Assignment_f *alpha, const MCGame_f *game,
            const ConstantSymbol *sym) {
 #if USE_CACHE
+        if (!_admission.admits(formula, CacheApplyGameKey::hash(formula, alpha, game, sym)))
+            return CachePin<Value>();
         CacheApplyGameKey key(formula, alpha, game, sym);
-	return _container.lookup(key);
+	CachePin<Value> pin = _container.lookup(key, formula->height());
+        _admission.record(formula, !pin.empty());
+        return pin;
 #else
-        return 0;
+        return CachePin<Value>();
 #endif
     }
 
-    void resize(size_t size) {
-        _container.resize(size);
+    void resize(size_t max_bytes) {
+        _container.resize(max_bytes);
+    }
+    /**
+     * Whether the cache is (almost) filled up to its memory budget.
+     */
+    bool full() const {
+        return _container.bytes() >= _container.max_bytes() - _container.max_bytes() / 16;
+    }
+    size_t take_ghost_hits() {
+        return _container.take_ghost_hits();
+    }
+    CacheStatistics statistics() const {
+        return _container.statistics();
+    }
+    void eviction_policy(CacheEvictionPolicy policy) {
+        _container.eviction_policy(policy);
     }
 private:
     CacheImpl _container;
+    CacheAdmission _admission;
 };
 
 } } // namespace
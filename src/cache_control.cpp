@@ -20,14 +20,129 @@
  * @author Alexander Langer
  */
 #include "cache_control.h"
+#include "exceptions.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits>
+#include <stdlib.h>
 
 namespace sequoia {
 
+namespace {
+
+enum { CACHE_FORGET, CACHE_INTRODUCE, CACHE_JOIN, NUM_CACHES };
+
+// lookups hitting evicted entries to observe before moving memory
+const size_t REBALANCE_SAMPLES = 256;
+// memory moved per step resp. kept by each cache, as fractions of the total
+const size_t REBALANCE_STEP = 32;
+const size_t REBALANCE_MIN_SHARE = 16;
+
+boost::mutex budget_mutex;
+size_t total_budget = CACHE_DEFAULT_BYTES;
+size_t budget[NUM_CACHES] = {
+    CACHE_DEFAULT_BYTES / 3, CACHE_DEFAULT_BYTES / 3, CACHE_DEFAULT_BYTES / 3
+};
+size_t ghost_hits[NUM_CACHES] = { 0, 0, 0 };
+
+void
+apply_budget() {
+    cache_forget_resize(budget[CACHE_FORGET]);
+    cache_introduce_resize(budget[CACHE_INTRODUCE]);
+    cache_join_resize(budget[CACHE_JOIN]);
+}
+
+} // namespace
+
 void
-cache_resize(size_t cache_size) {
-    cache_forget_resize(cache_size);
-    cache_introduce_resize(cache_size);
-    cache_join_resize(cache_size);
+cache_resize(size_t max_bytes) {
+    boost::lock_guard<boost::mutex> lock(budget_mutex);
+    total_budget = max_bytes;
+    for (int i = 0; i < NUM_CACHES; i++) {
+	budget[i] = max_bytes / NUM_CACHES;
+	ghost_hits[i] = 0;
+    }
+    apply_budget();
+}
+
+void
+cache_rebalance() {
+    boost::unique_lock<boost::mutex> lock(budget_mutex, boost::try_to_lock);
+    if (!lock.owns_lock())
+	return; // someone else is rebalancing
+    ghost_hits[CACHE_FORGET] += cache_forget_ghost_hits();
+    ghost_hits[CACHE_INTRODUCE] += cache_introduce_ghost_hits();
+    ghost_hits[CACHE_JOIN] += cache_join_ghost_hits();
+    if (ghost_hits[CACHE_FORGET] + ghost_hits[CACHE_INTRODUCE]
+	+ ghost_hits[CACHE_JOIN] < REBALANCE_SAMPLES)
+	return;
+
+    // the marginal benefit of memory: additional hits per byte
+    int donor = 0, receiver = 0;
+    double benefit[NUM_CACHES];
+    for (int i = 0; i < NUM_CACHES; i++) {
+	benefit[i] = budget[i] == 0 ? 0.0 : (double)ghost_hits[i] / budget[i];
+	if (benefit[i] < benefit[donor]) donor = i;
+	if (benefit[i] > benefit[receiver]) receiver = i;
+	ghost_hits[i] = 0;
+    }
+    size_t step = total_budget / REBALANCE_STEP;
+    if (donor == receiver
+	|| budget[donor] < total_budget / REBALANCE_MIN_SHARE + step)
+	return;
+    budget[donor] -= step;
+    budget[receiver] += step;
+    apply_budget();
+}
+
+void
+cache_eviction(CacheEvictionPolicy policy) {
+    cache_forget_eviction(policy);
+    cache_introduce_eviction(policy);
+    cache_join_eviction(policy);
+}
+
+CacheEvictionPolicy
+cache_eviction_policy_from_string(const std::string &name) {
+    if (name == "lru")
+	return CACHE_EVICT_LRU;
+    if (name == "clock")
+	return CACHE_EVICT_CLOCK;
+    throw sequoia_usage_error("Unknown cache eviction policy: " + name);
+}
+
+size_t
+memory_size_from_string(const std::string &size) {
+    // sizes used to be numbers of entries, so plain numbers are likely
+    // meant as such and we insist on a unit
+    if (size == "0")
+	return 0;
+    if (size.empty() || !isdigit((unsigned char)size[0]))
+	throw sequoia_usage_error("Invalid memory size: " + size);
+    char *end;
+    errno = 0;
+    unsigned long long bytes = strtoull(size.c_str(), &end, 10);
+    if (errno == ERANGE)
+	throw sequoia_usage_error("Memory size too large: " + size);
+    std::string suffix(end);
+    unsigned int shift;
+    if (suffix == "K" || suffix == "k")
+	shift = 10;
+    else if (suffix == "M" || suffix == "m")
+	shift = 20;
+    else if (suffix == "G" || suffix == "g")
+	shift = 30;
+    else if (suffix.empty())
+	throw sequoia_usage_error("Memory size needs a unit (K, M, or G): " + size);
+    else
+	throw sequoia_usage_error("Invalid memory size: " + size);
+    if (bytes > (std::numeric_limits<size_t>::max() >> shift))
+	throw sequoia_usage_error("Memory size too large: " + size);
+    return (size_t)bytes << shift;
 }
 
 } // namespace
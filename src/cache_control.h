@@ -28,8 +28,46 @@
 
 namespace sequoia {
 
+/**
+ * Set the total memory budget of the caches in bytes.  The budget is
+ * split evenly among the forget, introduce, and join caches at first,
+ * and then moved between them by cache_rebalance().
+ */
+extern void
+cache_resize(size_t max_bytes);
+
+/**
+ * Shift part of the budget from the cache that would profit least from
+ * more memory to the one that would profit most, judging by the lookups
+ * that missed recently evicted entries (see CacheImpl).  Does nothing
+ * until enough such lookups have been observed.  Thread-safe and cheap,
+ * call it regularly while solving.
+ */
+extern void
+cache_rebalance();
+
+/**
+ * Set the eviction policy of all caches.  Use cache_forget_eviction()
+ * etc. to select the policy of a single cache.
+ */
 extern void
-cache_resize(size_t cache_size);
+cache_eviction(CacheEvictionPolicy policy);
+
+/**
+ * Parse "lru" or "clock".
+ * @throws sequoia_usage_error if name is neither
+ */
+extern CacheEvictionPolicy
+cache_eviction_policy_from_string(const std::string &name);
+
+/**
+ * Parse a memory size with a unit K, M, or G, e.g. "64M", into bytes.
+ * "0" needs no unit.
+ * @throws sequoia_usage_error if size has no unit, is negative, or
+ * does not fit into size_t
+ */
+extern size_t
+memory_size_from_string(const std::string &size);
 
 } // namespace
 
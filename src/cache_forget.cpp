@@ -21,6 +21,7 @@
  */
 #include "cache.h"
 #include "cache_forget.h"
+#include "cache_persistent.h"
 
 namespace sequoia {
 
@@ -40,28 +41,49 @@ cache_forget_store(const Formula *formula, const Assignment_f *alpha,
                    const MCGame_f *game, const ConstantSymbol *sym,
                    const CacheForgetValue *result) {
 #if USE_CACHE
-    if (formula == NULL || formula->height() < CACHE_CUTOFF) return;
-    internal::cache_forget.store(formula, alpha, game, sym, result);
+    if (formula == NULL) return;
+    if (internal::cache_forget.store(formula, alpha, game, sym, result))
+	cache_persistent_forget(formula, alpha, game, sym, result);
 #endif
 }
 
 /**
  * @see CacheApplyGame
  */
-const CacheForgetValue*
+CachePin<CacheForgetValue>
 cache_forget_lookup(const Formula *formula, const Assignment_f *alpha,
                     const MCGame_f *game, const ConstantSymbol *sym) {
 #if USE_CACHE
-    if (formula == NULL || formula->height() < CACHE_CUTOFF) return NULL;
+    if (formula == NULL) return CachePin<CacheForgetValue>();
     return internal::cache_forget.lookup(formula, alpha, game, sym);
 #else
-    return NULL;
+    return CachePin<CacheForgetValue>();
 #endif
 }
 
 void
-cache_forget_resize(size_t cache_size) {
-    internal::cache_forget.resize(cache_size);
+cache_forget_resize(size_t max_bytes) {
+    internal::cache_forget.resize(max_bytes);
+}
+
+bool
+cache_forget_full() {
+    return internal::cache_forget.full();
+}
+
+size_t
+cache_forget_ghost_hits() {
+    return internal::cache_forget.take_ghost_hits();
+}
+
+CacheStatistics
+cache_forget_statistics() {
+    return internal::cache_forget.statistics();
+}
+
+void
+cache_forget_eviction(CacheEvictionPolicy policy) {
+    internal::cache_forget.eviction_policy(policy);
 }
 
 } // namespace
@@ -35,12 +35,34 @@ cache_forget_store(const Formula *formula, const Assignment_f *alpha,
                    const MCGame_f *game, const ConstantSymbol *sym,
                    const CacheForgetValue *result);
 
-extern const CacheForgetValue*
+extern CachePin<CacheForgetValue>
 cache_forget_lookup(const Formula *formula, const Assignment_f *alpha,
                     const MCGame_f *game, const ConstantSymbol *sym);
 
 extern void
-cache_forget_resize(size_t cache_size);
+cache_forget_resize(size_t max_bytes);
+
+/**
+ * Whether the cache is (almost) filled up to its memory budget.
+ */
+extern bool
+cache_forget_full();
+
+/**
+ * Number of lookups since the last call that missed the cache, but
+ * would have hit a cache of twice the size.
+ */
+extern size_t
+cache_forget_ghost_hits();
+
+/**
+ * Counters of the cache's operations by formula height.
+ */
+extern CacheStatistics
+cache_forget_statistics();
+
+extern void
+cache_forget_eviction(CacheEvictionPolicy policy);
 
 } // namespace
 
@@ -23,6 +23,7 @@
 
 #include "cache.h"
 #include "cache_introduce.h"
+#include "cache_persistent.h"
 
 namespace sequoia {
 
@@ -42,28 +43,49 @@ cache_introduce_store(const Formula *formula, const Assignment_f *alpha,
                       const MCGame_f *game, const ConstantSymbol *sym,
                       const CacheIntroduceValue *result) {
 #if USE_CACHE
-    if (formula == NULL || formula->height() < CACHE_CUTOFF) return;
-    internal::cache_introduce.store(formula, alpha, game, sym, result);
+    if (formula == NULL) return;
+    if (internal::cache_introduce.store(formula, alpha, game, sym, result))
+	cache_persistent_introduce(formula, alpha, game, sym, result);
 #endif
 }
 
 /**
  * @see CacheApplyGame
  */
-const CacheIntroduceValue*
+CachePin<CacheIntroduceValue>
 cache_introduce_lookup(const Formula *formula, const Assignment_f *alpha,
                        const MCGame_f *game, const ConstantSymbol *sym) {
 #if USE_CACHE
-    if (formula == NULL || formula->height() < CACHE_CUTOFF) return NULL;
+    if (formula == NULL) return CachePin<CacheIntroduceValue>();
     return internal::cache_introduce.lookup(formula, alpha, game, sym);
 #else
-    return NULL;
+    return CachePin<CacheIntroduceValue>();
 #endif
 }
 
 void
-cache_introduce_resize(size_t cache_size) {
-    internal::cache_introduce.resize(cache_size);
+cache_introduce_resize(size_t max_bytes) {
+    internal::cache_introduce.resize(max_bytes);
+}
+
+bool
+cache_introduce_full() {
+    return internal::cache_introduce.full();
+}
+
+size_t
+cache_introduce_ghost_hits() {
+    return internal::cache_introduce.take_ghost_hits();
+}
+
+CacheStatistics
+cache_introduce_statistics() {
+    return internal::cache_introduce.statistics();
+}
+
+void
+cache_introduce_eviction(CacheEvictionPolicy policy) {
+    internal::cache_introduce.eviction_policy(policy);
 }
 
 
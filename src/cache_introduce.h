@@ -54,21 +54,53 @@ public:
     void add(const Assignment_f *a, const MCGame_f *g) {
 	_container.push_back(std::make_pair(a, g));
     }
+    size_t size() const { return _container.size(); }
 private:
     Container _container;
 };
 
+/**
+ * The value's items and the flyweight handles they point to.
+ */
+inline size_t cache_bytes(const CacheIntroduceValue &value) {
+    return sizeof(value) + value.size() *
+	(sizeof(CacheIntroduceValue::CacheIntroduceValueItem)
+	 + sizeof(Assignment_f) + sizeof(MCGame_f));
+}
+
 extern void
 cache_introduce_store(const Formula *formula, const Assignment_f *alpha,
                       const MCGame_f *game, const ConstantSymbol *sym,
                       const CacheIntroduceValue *result);
 
-extern const CacheIntroduceValue*
+extern CachePin<CacheIntroduceValue>
 cache_introduce_lookup(const Formula *formula, const Assignment_f *alpha,
                        const MCGame_f *game, const ConstantSymbol *sym);
 
 extern void
-cache_introduce_resize(size_t cache_size);
+cache_introduce_resize(size_t max_bytes);
+
+/**
+ * Whether the cache is (almost) filled up to its memory budget.
+ */
+extern bool
+cache_introduce_full();
+
+/**
+ * Number of lookups since the last call that missed the cache, but
+ * would have hit a cache of twice the size.
+ */
+extern size_t
+cache_introduce_ghost_hits();
+
+/**
+ * Counters of the cache's operations by formula height.
+ */
+extern CacheStatistics
+cache_introduce_statistics();
+
+extern void
+cache_introduce_eviction(CacheEvictionPolicy policy);
 
 } // namespace
 
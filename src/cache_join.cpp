@@ -21,6 +21,7 @@
  */
 #include "cache.h"
 #include "cache_join.h"
+#include "cache_persistent.h"
 #include "unordered_defs.h"
 
 namespace sequoia {
@@ -46,11 +47,19 @@ public:
 	return true;
     }
     size_t hash() const {
+	return hash(_formula, &_alpha, &_game_left, &_game_right);
+    }
+    /**
+     * The hash value of the key for these parameters, without creating
+     * the key.
+     */
+    static size_t hash(const Formula *formula, const Assignment_f *alpha,
+		       const MCGame_f *game_left, const MCGame_f *game_right) {
 	size_t h = hash_init();
-	hash_combine(h, _formula->hash());
-	hash_combine(h, _alpha.get()->hash());
-	hash_combine(h, _game_left.get()->hash());
-	hash_combine(h, _game_right.get()->hash());
+	hash_combine(h, formula->hash());
+	hash_combine(h, flyweight_hash(*alpha));
+	hash_combine(h, flyweight_hash(*game_left));
+	hash_combine(h, flyweight_hash(*game_right));
 	return h;
     }
 private:
@@ -68,26 +77,31 @@ class CacheJoin {
     > CacheImpl;
 public:
     /**
-     * Stores the entry. Will internally create clones of all parameters.
+     * Stores the entry, unless the formula bypasses the cache (see
+     * CacheAdmission). Will internally create clones of all parameters.
      * No external cloning required.
+     * @return false if the formula bypasses the cache
      */
-    void
+    bool
     store(const Formula *formula, const Assignment_f *alpha,
 	  const MCGame_f *game_left, const MCGame_f *game_right, 
 	  const CacheJoinValue *result) {
 #if USE_CACHE
 	const MCGame_f *a = (game_left->get() < game_right->get() ? game_left : game_right);
 	const MCGame_f *b = (game_left->get() < game_right->get() ? game_right : game_left);
+	if (!_admission.admits(formula, CacheJoinKey::hash(formula, alpha, a, b)))
+	    return false;
         const CacheJoinKey *key = new CacheJoinKey(formula, alpha, a, b);
-	_container.store(key, result->clone());
+	_container.store(key, result->clone(), formula->height());
+	return true;
 #else
-        return;
+        return false;
 #endif
     }
     /**
-     * Returns an entry or NULL if nonexistent. Entry must be deleted after usage.
+     * Returns a pin of the entry, empty if nonexistent.
      */
-    const CacheJoinValue*
+    CachePin<CacheJoinValue>
     lookup(const Formula *formula,
            const Assignment_f *alpha,
 	   const MCGame_f *game_left,
@@ -95,18 +109,38 @@ public:
 #if USE_CACHE
 	const MCGame_f *a = (game_left->get() < game_right->get() ? game_left : game_right);
 	const MCGame_f *b = (game_left->get() < game_right->get() ? game_right : game_left);
+	if (!_admission.admits(formula, CacheJoinKey::hash(formula, alpha, a, b)))
+	    return CachePin<CacheJoinValue>();
         CacheJoinKey key(formula, alpha, a, b);
-        return _container.lookup(&key);
+        CachePin<CacheJoinValue> pin = _container.lookup(&key, formula->height());
+	_admission.record(formula, !pin.empty());
+	return pin;
 #else
-        return NULL;
+        return CachePin<CacheJoinValue>();
 #endif
     }
 
-    void resize(size_t size) {
-	_container.resize(size);
+    void resize(size_t max_bytes) {
+	_container.resize(max_bytes);
+    }
+    /**
+     * Whether the cache is (almost) filled up to its memory budget.
+     */
+    bool full() const {
+	return _container.bytes() >= _container.max_bytes() - _container.max_bytes() / 16;
+    }
+    size_t take_ghost_hits() {
+	return _container.take_ghost_hits();
+    }
+    CacheStatistics statistics() const {
+	return _container.statistics();
+    }
+    void eviction_policy(CacheEvictionPolicy policy) {
+	_container.eviction_policy(policy);
     }
 private:
     CacheImpl _container;
+    CacheAdmission _admission;
 };
 
 CacheJoin cache_join;
@@ -121,30 +155,51 @@ cache_join_store(const Formula *formula,
 		 const CacheJoinValue *result) {
 #if USE_CACHE
     assert(game_left->get()->formula() == game_right->get()->formula());
-    if (formula == NULL || formula->height() < CACHE_CUTOFF) return;
-    internal::cache_join.store(formula, alpha, game_left, game_right, result);
+    if (formula == NULL) return;
+    if (internal::cache_join.store(formula, alpha, game_left, game_right, result))
+	cache_persistent_join(formula, alpha, game_left, game_right, result);
 #else
     return;
 #endif
 }
 
-const CacheJoinValue*
+CachePin<CacheJoinValue>
 cache_join_lookup(const Formula *formula,
                   const Assignment_f *alpha,
 		  const MCGame_f *game_left,
 		  const MCGame_f *game_right) {
 #if USE_CACHE
     assert(game_left->get()->formula() == game_right->get()->formula());
-    if (formula == NULL || formula->height() < CACHE_CUTOFF) return NULL;
+    if (formula == NULL) return CachePin<CacheJoinValue>();
     return internal::cache_join.lookup(formula, alpha, game_left, game_right);
 #else
-    return NULL;
+    return CachePin<CacheJoinValue>();
 #endif
 }
 
 void
-cache_join_resize(size_t cache_size) {
-    internal::cache_join.resize(cache_size);
+cache_join_resize(size_t max_bytes) {
+    internal::cache_join.resize(max_bytes);
+}
+
+bool
+cache_join_full() {
+    return internal::cache_join.full();
+}
+
+size_t
+cache_join_ghost_hits() {
+    return internal::cache_join.take_ghost_hits();
+}
+
+CacheStatistics
+cache_join_statistics() {
+    return internal::cache_join.statistics();
+}
+
+void
+cache_join_eviction(CacheEvictionPolicy policy) {
+    internal::cache_join.eviction_policy(policy);
 }
 
 
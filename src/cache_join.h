@@ -22,6 +22,8 @@
 #ifndef SEQUOIA_CACHE_JOIN_H
 #define	SEQUOIA_CACHE_JOIN_H
 
+#include "cache_pin.h"
+#include "cache_statistics.h"
 #include "game.h"
 #include "logic/assignment.h"
 
@@ -36,14 +38,36 @@ cache_join_store(const Formula *formula,
 		 const MCGame_f *game_right,
 		 const CacheJoinValue *result);
 
-extern const CacheJoinValue *
+extern CachePin<CacheJoinValue>
 cache_join_lookup(const Formula *formula,
                   const Assignment_f *alpha,
 		  const MCGame_f *game_left,
 		  const MCGame_f *game_right);
 
 extern void
-cache_join_resize(size_t cache_size);
+cache_join_resize(size_t max_bytes);
+
+/**
+ * Whether the cache is (almost) filled up to its memory budget.
+ */
+extern bool
+cache_join_full();
+
+/**
+ * Number of lookups since the last call that missed the cache, but
+ * would have hit a cache of twice the size.
+ */
+extern size_t
+cache_join_ghost_hits();
+
+/**
+ * Counters of the cache's operations by formula height.
+ */
+extern CacheStatistics
+cache_join_statistics();
+
+extern void
+cache_join_eviction(CacheEvictionPolicy policy);
 
 
 } // namespace
@@ -0,0 +1,413 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "cache_persistent.h"
+#include "exceptions.h"
+#include "object_serializer.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+
+namespace sequoia {
+
+namespace {
+
+/*
+ * File layout: the header (magic, version, fingerprint of the formula
+ * and its symbols) followed by the entries.  Each entry is its payload
+ * length, the length of the key at the beginning of the payload, a
+ * checksum of the payload and the payload, written by an ObjectWriter.
+ * Integers are written in the byte order of the machine, a file from a
+ * machine with a different byte order fails the version check.
+ */
+const char CACHE_FILE_MAGIC[8] = { 'S', 'Q', 'C', 'A', 'C', 'H', 'E', '\n' };
+const uint32_t CACHE_FILE_VERSION = 2;
+// entries are appended in batches of about this many bytes
+const size_t CACHE_FILE_BATCH = 1 << 16;
+
+enum { ENTRY_FORGET, ENTRY_INTRODUCE, ENTRY_JOIN };
+
+uint64_t
+checksum(const char *data, size_t len) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+	h ^= (unsigned char)data[i];
+	h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Serializes one cache entry.
+ */
+class EntryWriter {
+public:
+    explicit EntryWriter(const FormulaIndex &index)
+    : _writer(index), _key_size(0) { }
+    const std::string& payload() const { return _writer.buffer(); }
+    size_t key_size() const { return _key_size; }
+
+    /**
+     * Write the key of a forget or introduce entry.
+     */
+    void key(uint8_t kind, const Formula *formula, const Assignment_f *alpha,
+	     const MCGame_f *game, const ConstantSymbol *sym) {
+	_writer.put8(kind);
+	_writer.put_formula(formula);
+	_writer.put_alpha(alpha);
+	_writer.put_game(game);
+	_writer.put_symbol(sym);
+	_key_size = payload().size();
+    }
+    /**
+     * Write the key of a join entry.
+     */
+    void key(const Formula *formula, const Assignment_f *alpha,
+	     const MCGame_f *game_left, const MCGame_f *game_right) {
+	_writer.put8(ENTRY_JOIN);
+	_writer.put_formula(formula);
+	_writer.put_alpha(alpha);
+	_writer.put_game(game_left);
+	_writer.put_game(game_right);
+	_key_size = payload().size();
+    }
+    void value(const MCGame_f *result) {
+	_writer.put_game(result);
+    }
+    void value(const CacheIntroduceValue *result) {
+	_writer.put32(result->size());
+	CacheIntroduceValue::const_iterator it;
+	for (it = result->begin(); it != result->end(); ++it) {
+	    _writer.put_alpha(it->first);
+	    _writer.put_game(it->second);
+	}
+    }
+
+private:
+    ObjectWriter _writer;
+    size_t _key_size;
+};
+
+/**
+ * Reconstructs one cache entry and stores it in the caches.
+ */
+class EntryReader {
+public:
+    EntryReader(const FormulaIndex &index, const char *data, size_t len)
+    : _reader(index, data, len) { }
+
+    void load() {
+	uint8_t kind = _reader.get8();
+	const Formula *formula = _reader.get_formula();
+	const Assignment_f *alpha = _reader.get_alpha();
+	if (kind == ENTRY_FORGET) {
+	    const MCGame_f *game = _reader.get_game();
+	    const ConstantSymbol *sym = _reader.get_symbol<ConstantSymbol>();
+	    const MCGame_f *result = _reader.get_game();
+	    _reader.check_end();
+	    cache_forget_store(formula, alpha, game, sym, result);
+	} else if (kind == ENTRY_INTRODUCE) {
+	    const MCGame_f *game = _reader.get_game();
+	    const ConstantSymbol *sym = _reader.get_symbol<ConstantSymbol>();
+	    uint32_t n = _reader.get32();
+	    CacheIntroduceValue result;
+	    for (uint32_t i = 0; i < n; i++) {
+		const Assignment_f *a = _reader.get_alpha();
+		const MCGame_f *g = _reader.get_game();
+		result.add(a->clone(), g->clone());
+	    }
+	    _reader.check_end();
+	    cache_introduce_store(formula, alpha, game, sym, &result);
+	} else if (kind == ENTRY_JOIN) {
+	    const MCGame_f *game_left = _reader.get_game();
+	    const MCGame_f *game_right = _reader.get_game();
+	    const MCGame_f *result = _reader.get_game();
+	    _reader.check_end();
+	    cache_join_store(formula, alpha, game_left, game_right, result);
+	} else {
+	    throw unknown_object();
+	}
+    }
+
+private:
+    ObjectReader _reader;
+};
+
+class CacheFile {
+public:
+    CacheFile(const std::string &path, const Formula *formula)
+    : _path(path), _index(formula), _file(NULL), _end(0), _loaded(0) {
+	_file = ::fopen(path.c_str(), "r+b");
+	if (_file == NULL)
+	    _file = ::fopen(path.c_str(), "w+b");
+	if (_file == NULL)
+	    throw sequoia_file_error("Cannot open cache file " + path);
+	std::vector<char> data;
+	if (::fseek(_file, 0, SEEK_END) == 0) {
+	    long size = ::ftell(_file);
+	    if (size > 0) {
+		data.resize(size);
+		::rewind(_file);
+		if (::fread(&data[0], 1, size, _file) != (size_t)size)
+		    data.clear();
+	    }
+	}
+	size_t end = load(data);
+	if (end == 0) {
+	    if (!data.empty())
+		std::cout << "Cache file " << path
+			  << " was written for another formula, starting anew."
+			  << std::endl;
+	    write_header();
+	} else if (end < data.size()) {
+	    // drop an incomplete entry, e.g., of a run that was killed
+	    ::fflush(_file);
+	    if (::ftruncate(::fileno(_file), end) != 0)
+		throw sequoia_file_error("Cannot truncate cache file " + path);
+	}
+	if (::fseek(_file, 0, SEEK_END) != 0 || ::fflush(_file) != 0)
+	    throw sequoia_file_error("Cannot write cache file " + path);
+	_end = ::ftell(_file);
+    }
+    ~CacheFile() {
+	flush();
+	if (_file != NULL)
+	    ::fclose(_file);
+    }
+    size_t loaded() const { return _loaded; }
+    const FormulaIndex& index() const { return _index; }
+
+    /**
+     * Whether the file contains an entry with the key written to entry,
+     * or takes no more entries since writing it failed.
+     */
+    bool contains(const EntryWriter &entry) {
+	uint64_t key = checksum(entry.payload().data(), entry.key_size());
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _file == NULL || _keys.find(key) != _keys.end();
+    }
+    /**
+     * Append the entry, unless the file contains an entry with the same
+     * key already.  Entries are collected and written in batches.  The
+     * cache file is optional, so if writing fails, we warn, drop the
+     * batch and stop appending, but the solver continues.
+     */
+    void append(const EntryWriter &entry) {
+	const std::string &payload = entry.payload();
+	uint32_t len = payload.size();
+	uint32_t key_len = entry.key_size();
+	uint64_t key = checksum(payload.data(), key_len);
+	uint64_t sum = checksum(payload.data(), len);
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	if (_file == NULL || !_keys.insert(key).second)
+	    return;
+	_pending.append((const char*)&len, sizeof(len));
+	_pending.append((const char*)&key_len, sizeof(key_len));
+	_pending.append((const char*)&sum, sizeof(sum));
+	_pending.append(payload);
+	if (_pending.size() >= CACHE_FILE_BATCH)
+	    write_pending();
+    }
+    /**
+     * Write the pending entries.
+     */
+    void flush() {
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	write_pending();
+    }
+private:
+    CacheFile(const CacheFile&);
+    CacheFile& operator=(const CacheFile&);
+
+    /**
+     * Write the pending entries, which are complete, at the end of the
+     * file.  If this fails, cut the file back to the entries before,
+     * such that it ends with a complete entry, and close it.
+     */
+    void write_pending() {
+	if (_file == NULL || _pending.empty())
+	    return;
+	if (::fwrite(_pending.data(), 1, _pending.size(), _file) == _pending.size()
+	    && ::fflush(_file) == 0) {
+	    _end += _pending.size();
+	    _pending.clear();
+	    return;
+	}
+	std::cerr << "WARNING:  Cannot write cache file " << _path
+		  << ", no longer adding entries to it." << std::endl;
+	_pending.clear();
+	::clearerr(_file);
+	if (::ftruncate(::fileno(_file), _end) != 0)
+	    std::cerr << "WARNING:  Cannot truncate cache file " << _path
+		      << ", the next run drops the incomplete entry." << std::endl;
+	::fclose(_file);
+	_file = NULL;
+    }
+
+    std::string header() const {
+	std::string h(CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+	uint32_t version = CACHE_FILE_VERSION;
+	uint32_t len = _index.fingerprint().size();
+	h.append((const char*)&version, sizeof(version));
+	h.append((const char*)&len, sizeof(len));
+	h.append(_index.fingerprint());
+	return h;
+    }
+    void write_header() {
+	::fflush(_file);
+	if (::ftruncate(::fileno(_file), 0) != 0)
+	    throw sequoia_file_error("Cannot truncate cache file " + _path);
+	::rewind(_file);
+	std::string h = header();
+	if (::fwrite(h.data(), 1, h.size(), _file) != h.size())
+	    throw sequoia_file_error("Cannot write cache file " + _path);
+    }
+    /**
+     * Load the entries of data into the caches.
+     * @return the end of the last complete entry, 0 if the header does
+     * not match
+     */
+    size_t load(const std::vector<char> &data) {
+	std::string h = header();
+	if (data.size() < h.size() || ::memcmp(&data[0], h.data(), h.size()) != 0)
+	    return 0;
+	const size_t entry_header = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+	size_t pos = h.size();
+	while (data.size() - pos >= entry_header) {
+	    uint32_t len, key_len;
+	    uint64_t sum;
+	    ::memcpy(&len, &data[pos], sizeof(len));
+	    ::memcpy(&key_len, &data[pos + sizeof(len)], sizeof(key_len));
+	    ::memcpy(&sum, &data[pos + 2 * sizeof(len)], sizeof(sum));
+	    size_t start = pos + entry_header;
+	    if (data.size() - start < len || key_len == 0 || key_len > len
+		|| checksum(&data[start], len) != sum)
+		break;
+	    pos = start + len;
+	    _keys.insert(checksum(&data[start], key_len));
+	    // loading more than fits only evicts what we loaded before
+	    if (full(data[start]))
+		continue;
+	    try {
+		EntryReader reader(_index, &data[start], len);
+		reader.load();
+		_loaded++;
+	    } catch (const unknown_object&) {
+		// written by an incompatible version, skip it
+	    }
+	}
+	return pos;
+    }
+    static bool full(uint8_t kind) {
+	switch (kind) {
+	case ENTRY_FORGET: return cache_forget_full();
+	case ENTRY_INTRODUCE: return cache_introduce_full();
+	case ENTRY_JOIN: return cache_join_full();
+	default: return true;
+	}
+    }
+
+    std::string _path;
+    FormulaIndex _index;
+    FILE *_file;       // NULL once writing failed
+    off_t _end;        // end of the entries written
+    std::string _pending; // entries not written yet
+    size_t _loaded;
+    SEQUOIA_UNORDERED_SET<uint64_t> _keys; // checksums of the keys in the file
+    boost::mutex _mutex;
+};
+
+CacheFile *cache_file = NULL;
+
+} // namespace
+
+size_t
+cache_persistent_open(const std::string &path, const Formula *formula) {
+    cache_persistent_close();
+    CacheFile *file = new CacheFile(path, formula);
+    // only now, such that the loaded entries are not appended again
+    cache_file = file;
+    return file->loaded();
+}
+
+void
+cache_persistent_close() {
+    delete cache_file;
+    cache_file = NULL;
+}
+
+void
+cache_persistent_forget(const Formula *formula, const Assignment_f *alpha,
+                        const MCGame_f *game, const ConstantSymbol *sym,
+                        const CacheForgetValue *result) {
+    if (cache_file == NULL) return;
+    EntryWriter writer(cache_file->index());
+    try {
+	writer.key(ENTRY_FORGET, formula, alpha, game, sym);
+	if (cache_file->contains(writer)) return;
+	writer.value(result);
+    } catch (const unknown_object&) {
+	return;
+    }
+    cache_file->append(writer);
+}
+
+void
+cache_persistent_introduce(const Formula *formula, const Assignment_f *alpha,
+                           const MCGame_f *game, const ConstantSymbol *sym,
+                           const CacheIntroduceValue *result) {
+    if (cache_file == NULL) return;
+    EntryWriter writer(cache_file->index());
+    try {
+	writer.key(ENTRY_INTRODUCE, formula, alpha, game, sym);
+	if (cache_file->contains(writer)) return;
+	writer.value(result);
+    } catch (const unknown_object&) {
+	return;
+    }
+    cache_file->append(writer);
+}
+
+void
+cache_persistent_join(const Formula *formula, const Assignment_f *alpha,
+                      const MCGame_f *game_left, const MCGame_f *game_right,
+                      const CacheJoinValue *result) {
+    if (cache_file == NULL) return;
+    EntryWriter writer(cache_file->index());
+    try {
+	writer.key(formula, alpha, game_left, game_right);
+	if (cache_file->contains(writer)) return;
+	writer.value(result);
+    } catch (const unknown_object&) {
+	return;
+    }
+    cache_file->append(writer);
+}
+
+} // namespace
@@ -0,0 +1,79 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_CACHE_PERSISTENT_H
+#define	SEQUOIA_CACHE_PERSISTENT_H
+
+#include "cache_forget.h"
+#include "cache_introduce.h"
+#include "cache_join.h"
+
+#include <string>
+
+namespace sequoia {
+
+/**
+ * The cache entries can be kept in a file to be reused by later runs on
+ * the same formula.  The file is an append-only log of the entries
+ * stored in the caches.  Formulas, symbols, moves, assignments and games
+ * are written by their position in the formula resp. by value, so the
+ * log does not depend on the memory layout of the run that wrote it.
+ *
+ * Opening the file loads the entries of previous runs into the caches,
+ * if the file was written for the same formula over the same vocabulary.
+ * The entries do not depend on the graph, but the nesting depths of the
+ * symbols depend on the width of the tree decomposition, so the file is
+ * shared by runs on graphs of the same width.  Otherwise, the file is
+ * started anew.  Entries are loaded until the caches are full.  From
+ * then on, each entry stored in a cache is appended to the file, unless
+ * the file contains one with the same key already.
+ *
+ * @param path the file
+ * @param formula the formula that is solved
+ * @return the number of entries loaded
+ */
+extern size_t
+cache_persistent_open(const std::string &path, const Formula *formula);
+
+/**
+ * Flush and close the file, entries are no longer appended.
+ */
+extern void
+cache_persistent_close();
+
+extern void
+cache_persistent_forget(const Formula *formula, const Assignment_f *alpha,
+                        const MCGame_f *game, const ConstantSymbol *sym,
+                        const CacheForgetValue *result);
+
+extern void
+cache_persistent_introduce(const Formula *formula, const Assignment_f *alpha,
+                           const MCGame_f *game, const ConstantSymbol *sym,
+                           const CacheIntroduceValue *result);
+
+extern void
+cache_persistent_join(const Formula *formula, const Assignment_f *alpha,
+                      const MCGame_f *game_left, const MCGame_f *game_right,
+                      const CacheJoinValue *result);
+
+} // namespace
+
+#endif	// SEQUOIA_CACHE_PERSISTENT_H
@@ -0,0 +1,106 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_CACHE_PIN_H
+#define	SEQUOIA_CACHE_PIN_H
+
+#include "common.h"
+
+#ifdef HAVE_TBB
+#include <tbb/atomic.h>
+#else
+#include <atomic>
+#endif
+
+#include <cassert>
+
+namespace sequoia {
+
+namespace internal {
+
+/**
+ * The reference counted part of a cache entry.  The cache holds one
+ * reference to each of its entries and every CachePin another, so an
+ * entry evicted while pinned is freed when the last pin is released.
+ */
+template <typename Value> class CacheEntryBase {
+public:
+    explicit CacheEntryBase(const Value* value) : _value(value) { _refs = 1; }
+    virtual ~CacheEntryBase() { delete _value; }
+    const Value* value() const { return _value; }
+    void acquire() const { _refs++; }
+    void release() const {
+        if (--_refs == 0)
+            delete this;
+    }
+private:
+    CacheEntryBase(const CacheEntryBase&);
+    CacheEntryBase& operator=(const CacheEntryBase&);
+#ifdef HAVE_TBB
+    typedef tbb::atomic<size_t> Counter;
+#else
+    typedef std::atomic<size_t> Counter;
+#endif
+    const Value* _value;
+    mutable Counter _refs;
+};
+
+} // namespace internal
+
+/**
+ * A handle to a cached value that keeps the value alive, even if it is
+ * evicted from the cache meanwhile.  Obtaining and releasing a pin does
+ * not allocate memory.  Pins are empty if the lookup failed.
+ */
+template <typename Value> class CachePin {
+    typedef internal::CacheEntryBase<Value> Entry;
+public:
+    CachePin() : _entry(NULL) { }
+    /**
+     * Adopt a reference to entry.
+     */
+    explicit CachePin(const Entry* entry) : _entry(entry) { }
+    CachePin(const CachePin& other) : _entry(other._entry) {
+        if (_entry != NULL)
+            _entry->acquire();
+    }
+    CachePin(CachePin&& other) : _entry(other._entry) { other._entry = NULL; }
+    ~CachePin() {
+        if (_entry != NULL)
+            _entry->release();
+    }
+    CachePin& operator=(CachePin other) {
+        const Entry* tmp = _entry;
+        _entry = other._entry;
+        other._entry = tmp;
+        return *this;
+    }
+    bool empty() const { return _entry == NULL; }
+    const Value* get() const { return _entry != NULL ? _entry->value() : NULL; }
+    const Value* operator->() const { assert(_entry != NULL); return _entry->value(); }
+    const Value& operator*() const { assert(_entry != NULL); return *_entry->value(); }
+private:
+    const Entry* _entry;
+};
+
+} // namespace
+
+#endif	/* SEQUOIA_CACHE_PIN_H */
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ * 
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "cache_statistics.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace sequoia {
+
+namespace {
+const CacheStatistics::Counters no_counters;
+}
+
+const unsigned int CacheStatistics::MAX_HEIGHT;
+
+CacheStatistics::Counters&
+CacheStatistics::Counters::operator+=(const Counters& other) {
+    lookups += other.lookups;
+    hits += other.hits;
+    stores += other.stores;
+    evictions += other.evictions;
+    duplicates += other.duplicates;
+    rejected += other.rejected;
+    return *this;
+}
+
+const CacheStatistics::Counters&
+CacheStatistics::height(unsigned int height) const {
+    if (height >= _heights.size())
+	return no_counters;
+    return _heights[height];
+}
+
+CacheStatistics::Counters
+CacheStatistics::total() const {
+    Counters sum;
+    for (unsigned int i = 0; i < _heights.size(); i++)
+	sum += _heights[i];
+    return sum;
+}
+
+void
+CacheStatistics::add(unsigned int height, const Counters& counters) {
+    if (counters.lookups == 0 && counters.stores == 0 && counters.duplicates == 0
+	&& counters.evictions == 0 && counters.rejected == 0)
+	return;
+    if (height > MAX_HEIGHT)
+	height = MAX_HEIGHT;
+    if (height >= _heights.size())
+	_heights.resize(height + 1);
+    _heights[height] += counters;
+}
+
+CacheStatistics&
+CacheStatistics::operator+=(const CacheStatistics& other) {
+    for (unsigned int i = 0; i < other._heights.size(); i++)
+	add(i, other._heights[i]);
+    return *this;
+}
+
+void
+CacheStatistics::print_summary(std::ostream& os) const {
+    Counters sum = total();
+    os << sum.hits << "/" << sum.lookups;
+    if (sum.lookups > 0)
+	os << " (" << (100 * sum.hits / sum.lookups) << "%)";
+}
+
+void
+CacheStatistics::print(std::ostream& os) const {
+    os << std::setw(8) << "height" << std::setw(12) << "lookups"
+       << std::setw(12) << "hits" << std::setw(12) << "stores"
+       << std::setw(12) << "evictions" << std::setw(12) << "duplicates"
+       << std::setw(12) << "rejected" << std::endl;
+    for (unsigned int i = 0; i < _heights.size(); i++) {
+	const Counters& c = _heights[i];
+	if (c.lookups == 0 && c.stores == 0 && c.duplicates == 0
+	    && c.evictions == 0 && c.rejected == 0)
+	    continue;
+	if (i == MAX_HEIGHT) {
+	    std::stringstream label;
+	    label << ">=" << i;
+	    os << std::setw(8) << label.str();
+	} else {
+	    os << std::setw(8) << i;
+	}
+	os << std::setw(12) << c.lookups
+	   << std::setw(12) << c.hits << std::setw(12) << c.stores
+	   << std::setw(12) << c.evictions << std::setw(12) << c.duplicates
+	   << std::setw(12) << c.rejected << std::endl;
+    }
+}
+
+} // namespace
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ * 
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_CACHE_STATISTICS_H
+#define	SEQUOIA_CACHE_STATISTICS_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace sequoia {
+
+/**
+ * A snapshot of a cache's counters, broken down by the height of the
+ * formula the entries were computed for.  Use these to choose the cache
+ * size for a formula.
+ */
+class CacheStatistics {
+public:
+    struct Counters {
+        Counters()
+        : lookups(0), hits(0), stores(0), evictions(0), duplicates(0), rejected(0) { }
+        Counters& operator+=(const Counters& other);
+        size_t lookups;
+        size_t hits;
+        size_t stores;     // new entries only
+        size_t evictions;
+        size_t duplicates; // stores of existing entries
+        size_t rejected;   // stores refused by the admission policy
+    };
+
+    /**
+     * Heights of at least this are counted together, as this height.
+     */
+    static const unsigned int MAX_HEIGHT = 31;
+
+    /**
+     * One past the largest height with non-zero counters.
+     */
+    unsigned int heights() const { return _heights.size(); }
+    /**
+     * Counters of the entries for formulas of the given height.
+     */
+    const Counters& height(unsigned int height) const;
+    Counters total() const;
+
+    void add(unsigned int height, const Counters& counters);
+    CacheStatistics& operator+=(const CacheStatistics& other);
+
+    /**
+     * Print the totals in a single line.
+     */
+    void print_summary(std::ostream& os) const;
+    /**
+     * Print a table of the counters per formula height, the last row
+     * may cover all heights of at least MAX_HEIGHT.
+     */
+    void print(std::ostream& os) const;
+
+private:
+    std::vector<Counters> _heights;
+};
+
+} // namespace
+
+#endif	// SEQUOIA_CACHE_STATISTICS_H
@@ -31,6 +31,15 @@ std::ostream & tab_prefix(int i) {
     return std::cout << ret;
 }
 
+namespace internal {
+unsigned int move_words = 1;
+} // namespace internal
+
+void set_move_words(unsigned int words) {
+    assert(words > 0 && words <= SEQUOIA_MAX_MOVE_WORDS);
+    internal::move_words = words;
+}
+
 const char * str2char(std::string s) {
   int len = s.size() + 1;
   char* res = new char[len];
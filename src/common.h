@@ -24,7 +24,9 @@
 
 #include "../config.h"
 
-#include <bitset>
+#include "move_bitset.h"
+
+#include <cassert>
 #include <climits>  // INT_MIN
 #include <iostream>
 #include <string>
@@ -41,9 +43,28 @@ namespace sequoia {
 #endif
 
 // protect users from shooting into their feet: be conservative and
-// use relatively low cache values unless they read the documentation
-#define CACHE_DEFAULT_SIZE 10000
-#define CACHE_CUTOFF    3 // some tests show that this is reasonable
+// use a relatively low memory budget unless they read the documentation.
+// The budget (in bytes) is shared by the forget, introduce, and join caches
+#define CACHE_DEFAULT_BYTES (32UL << 20)
+// lookups per formula after which the caches reconsider whether to
+// cache the formula, see CacheAdmission
+#define CACHE_ADMISSION_WINDOW 64
+// the caches are shared by all threads and split into 2^CACHE_SHARD_BITS
+// independently locked shards
+#define CACHE_SHARD_BITS 4
+
+/**
+ * Eviction policies of the caches, see internal::CacheImpl.
+ */
+enum CacheEvictionPolicy { CACHE_EVICT_LRU, CACHE_EVICT_CLOCK };
+
+// the flyweight pools are split into 2^FLYWEIGHT_POOL_SHARD_BITS
+// independently locked shards
+#define FLYWEIGHT_POOL_SHARD_BITS 6
+
+// containers keyed by flyweights hash the address of the pooled object
+// instead of the object's (deep) hash value
+#define FLYWEIGHT_IDENTITY_HASHING 1
 
 #define TOSTRING(x) ((x) != NULL ? (x)->toString() : "(NULL)")
 #ifdef DODEBUG
@@ -56,13 +77,6 @@ namespace sequoia {
 #define DEBUG(x)
 #endif
 
-#ifdef DODEBUG
-#define BITSET_SIZE 16
-#else
-#define BITSET_SIZE (sizeof(unsigned long) * 8)
-#endif
-typedef std::bitset<BITSET_SIZE> BitSet;
-
 /**
  * Append i tabs ("\t") to std::cout and return it.
  */
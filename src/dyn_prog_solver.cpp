@@ -25,11 +25,17 @@
 #include "structures/graph_factory.h"
 #include "structures/treedecomposition_check.h"
 
-#include <list>
+#include <algorithm>
+#include <cmath>
 #include <vector>
+#include <boost/scoped_ptr.hpp>
 
 #ifdef HAVE_TBB
+#include <tbb/atomic.h>
 #include <tbb/task.h>
+#include <tbb/task_scheduler_observer.h>
+#else
+#include "work_stealing.h"
 #endif
 
 namespace sequoia {
@@ -86,39 +92,160 @@ void DynProgSolver::pre_solve() {
 
     int width = _treedecomposition->width();
     std::cout << "Tree decomposition has width: " << width - 1 << " (" << width << " cops)" << std::endl;
+
+    compute_subtree_costs();
 }
 
-#ifndef HAVE_TBB
-void DynProgSolver::solve() {
-    DPRINTLN("DynProgSolver::solve()");
-    this->pre_solve();
+double
+DynProgSolver::node_cost(const TreeDecomposition::vertex_descriptor& t) const {
+    const TreeDecomposition* tdc = _treedecomposition;
+    double cost = std::ldexp(1.0, std::min<int>(tdc->bag(t)->width(), 1000));
+    if (tdc->out_degree(t) == 2)
+        cost *= 2.0; // joins combine the games of both children
+    return cost;
+}
 
+/**
+ * Sum up node_cost() bottom-up in a post-order traversal.
+ */
+void DynProgSolver::compute_subtree_costs() {
     typedef TreeDecomposition::vertex_descriptor Vertex;
-    typedef TreeDecomposition::edge_descriptor Edge;
     typedef TreeDecomposition::out_edge_iterator OutEdgeIterator;
 
     const TreeDecomposition* tdc = _treedecomposition;
-
-    int counter = 0;
-    std::list<Vertex> stack;
+    _subtree_cost.assign(tdc->num_vertices(), 0.0);
     std::vector<bool> visited(tdc->num_vertices());
-    stack.push_front(tdc->root());
-    do {
-        Vertex v = stack.front();
-
-        if (visited[v] == false) {
-            OutEdgeIterator i, iend;
-            for (boost::tie(i, iend) = tdc->out_edges(v); i != iend; ++i) {
-                stack.push_front(tdc->target(*i));
-            }
+    std::vector<Vertex> stack;
+    stack.push_back(tdc->root());
+    while (!stack.empty()) {
+        Vertex v = stack.back();
+        OutEdgeIterator i, iend;
+        if (!visited[v]) {
             visited[v] = true;
-        } else {
-            stack.pop_front();
-            work_on(v);
+            for (boost::tie(i, iend) = tdc->out_edges(v); i != iend; ++i)
+                stack.push_back(tdc->target(*i));
+            continue;
         }
-    } while(stack.size() > 0);
-    do_root(tdc->root());
+        stack.pop_back();
+        double cost = node_cost(v);
+        for (boost::tie(i, iend) = tdc->out_edges(v); i != iend; ++i)
+            cost += _subtree_cost[tdc->target(*i)];
+        _subtree_cost[v] = cost;
+    }
+}
+
+namespace {
+
+struct heavier_subtree {
+    heavier_subtree(const DynProgSolver* s) : solver(s) { }
+    bool operator()(const TreeDecomposition::vertex_descriptor& a,
+                    const TreeDecomposition::vertex_descriptor& b) const {
+        return solver->subtree_cost(a) > solver->subtree_cost(b);
+    }
+    const DynProgSolver* solver;
+};
+
+/**
+ * The children of t, most expensive subtree first.
+ */
+std::vector<TreeDecomposition::vertex_descriptor>
+children_by_cost(const DynProgSolver* solver,
+                 const TreeDecomposition::vertex_descriptor& t) {
+    const TreeDecomposition* tdc = solver->treedecomposition();
+    std::vector<TreeDecomposition::vertex_descriptor> children;
+    TreeDecomposition::out_edge_iterator o, oend;
+    for (boost::tie(o, oend) = tdc->out_edges(t); o != oend; ++o)
+        children.push_back(tdc->target(*o));
+    std::stable_sort(children.begin(), children.end(), heavier_subtree(solver));
+    return children;
+}
+
+} // namespace
+
+#ifndef HAVE_TBB
+
+class DynProgContinuationTask : public WorkStealingTask {
+    typedef TreeDecomposition::vertex_descriptor Vertex;
+public:
+    DynProgContinuationTask(DynProgSolver *s, const Vertex v)
+    : solver(s), vertex(v) { }
+
+    WorkStealingTask* execute(WorkStealingExecutor& executor) {
+        solver->work_on(vertex);
+        return NULL;
+    }
+private:
+    DynProgSolver* solver;
+    const Vertex vertex;
+};
 
+class DynProgScheduleTask : public WorkStealingTask {
+public:
+    typedef TreeDecomposition::vertex_descriptor Vertex;
+
+    DynProgScheduleTask(DynProgSolver *s, const Vertex v)
+    : solver(s), vertex(v) { }
+
+    WorkStealingTask* execute(WorkStealingExecutor& executor) {
+        const TreeDecomposition* tdc = solver->treedecomposition();
+
+        if (tdc->out_degree(vertex) == 0) {
+            solver->do_leaf(vertex);
+            return NULL;
+        }
+
+	// schedule continuation task for this vertex
+	DynProgContinuationTask* c = new DynProgContinuationTask(solver, vertex);
+	continue_with(c);
+
+	// schedule dynprog tasks for all children of this node.  We continue
+	// with the most expensive child ourselves, the others are spawned
+	// by decreasing cost and thieves prefer the heaviest tasks.
+	std::vector<Vertex> children = children_by_cost(solver, vertex);
+	if (solver->memory_exhausted()) {
+	    // out of memory budget: don't spawn the siblings, but chain
+	    // them, each one is scheduled once the previous one completed.
+	    c->set_ref_count(1);
+	    WorkStealingTask* next = c;
+	    for (unsigned int i = children.size() - 1; i >= 1; i--) {
+		DynProgScheduleTask* lt = new DynProgScheduleTask(solver, children[i]);
+		lt->child_of(next);
+		lt->set_ref_count(1);
+		next = lt;
+	    }
+	    recycle_as_child_of(next);
+	    vertex = children[0];
+	    return this;
+	}
+	// the reference count must be set before any child can complete
+	c->set_ref_count(children.size());
+	for (unsigned int i = 1; i < children.size(); i++) {
+	    DynProgScheduleTask* lt = new DynProgScheduleTask(solver, children[i]);
+	    lt->child_of(c);
+	    lt->weight(solver->subtree_cost(children[i]));
+	    executor.spawn(lt);
+	}
+	recycle_as_child_of(c);
+	vertex = children[0];
+	return this;
+    }
+private:
+    DynProgSolver* solver;
+    Vertex vertex;
+};
+
+void DynProgSolver::solve() {
+    DPRINTLN("DynProgSolver::solve()");
+    NumaTopology topology;
+    bool pinned = _policy == SCHEDULE_SOCKET_PINNED;
+    WorkStealingExecutor executor(_threads, pinned ? &topology : NULL);
+    if (pinned)
+        std::cout << "Pinning " << executor.num_threads() << " threads to "
+                  << topology.num_nodes() << " NUMA node(s)" << std::endl;
+    this->pre_solve();
+    const TreeDecomposition* tdc = _treedecomposition;
+    executor.run(new DynProgScheduleTask(this, tdc->root()));
+    do_root(tdc->root());
     this->post_solve();
 }
 
@@ -205,19 +332,30 @@ public:
 	DynProgContinuationTask& c =
 		*new(tbb::task::allocate_continuation()) DynProgContinuationTask(solver, vertex);
 
-	// schedule dynprog tasks for all children of this node
-	TreeDecomposition::out_edge_iterator o, oend;
-	boost::tie(o, oend) = tdc->out_edges(vertex);
-	Vertex first_child = tdc->target(*o++);
-	int seen = 1;
-	for (; o != oend; o++) {
-            DynProgScheduleTask& lt = *new(c.allocate_child()) DynProgScheduleTask(solver, tdc->target(*o));
+	// schedule dynprog tasks for all children of this node.  We continue
+	// with the most expensive child ourselves, the others are spawned
+	// by decreasing cost.
+	std::vector<Vertex> children = children_by_cost(solver, vertex);
+	if (solver->memory_exhausted()) {
+	    // out of memory budget: chain the siblings instead, see above
+	    c.set_ref_count(1);
+	    tbb::task* next = &c;
+	    for (unsigned int i = children.size() - 1; i >= 1; i--) {
+		DynProgScheduleTask& lt = *new(next->allocate_child()) DynProgScheduleTask(solver, children[i]);
+		lt.set_ref_count(1);
+		next = &lt;
+	    }
+	    tbb::task::recycle_as_child_of(*next);
+	    vertex = children[0];
+	    return this;
+	}
+	c.set_ref_count(children.size());
+	for (unsigned int i = 1; i < children.size(); i++) {
+            DynProgScheduleTask& lt = *new(c.allocate_child()) DynProgScheduleTask(solver, children[i]);
 	    spawn(lt);
-	    seen++;
 	}
-	c.set_ref_count(seen);
 	tbb::task::recycle_as_child_of(c); 
-	vertex = first_child;
+	vertex = children[0];
 	return this;
     }
 private:
@@ -226,8 +364,37 @@ private:
 };
 
 
+/**
+ * Pins TBB's worker threads round-robin to the NUMA nodes as they join
+ * the scheduler.  The TBB scheduler offers no way to keep subtrees on a
+ * node, so only the threads are placed.
+ */
+class DynProgPinningObserver : public tbb::task_scheduler_observer {
+public:
+    DynProgPinningObserver(const NumaTopology* topology)
+    : _topology(topology) {
+        _next = 0;
+        observe(true);
+    }
+    ~DynProgPinningObserver() { observe(false); }
+    void on_scheduler_entry(bool is_worker) {
+        if (is_worker)
+            _topology->pin_current_thread(_next++ % _topology->num_nodes());
+    }
+private:
+    const NumaTopology* _topology;
+    tbb::atomic<size_t> _next;
+};
+
 void DynProgSolver::solve() {
     DPRINTLN("DynProgSolver::solve()");
+    NumaTopology topology;
+    boost::scoped_ptr<DynProgPinningObserver> observer;
+    if (_policy == SCHEDULE_SOCKET_PINNED) {
+        std::cout << "Pinning threads to " << topology.num_nodes()
+                  << " NUMA node(s)" << std::endl;
+        observer.reset(new DynProgPinningObserver(&topology));
+    }
     this->pre_solve();
     typedef TreeDecomposition::vertex_descriptor Vertex;
     typedef TreeDecomposition::edge_descriptor Edge;
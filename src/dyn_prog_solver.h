@@ -22,14 +22,19 @@
 #ifndef SEQUOIA_DYN_PROG_SOLVER_H
 #define	SEQUOIA_DYN_PROG_SOLVER_H
 
+#include "numa_topology.h"
 #include "structures/labeled_graph.h"
 #include "structures/treedecomposition.h"
 
+#include <vector>
+
 namespace sequoia {
 
 class DynProgSolver {
 public:
-    DynProgSolver() : _graph(NULL), _treedecomposition(NULL) { }
+    DynProgSolver()
+    : _graph(NULL), _treedecomposition(NULL), _threads(0),
+      _policy(SCHEDULE_ALL_CORES), _memory_budget(0) { }
     virtual void load_graph(const char *filename);
     virtual void load_treedecomposition(const char *filename);
     virtual void solve();
@@ -43,6 +48,36 @@ public:
     void treedecomposition(TreeDecomposition* treedecomposition) {
         this->_treedecomposition = treedecomposition;
     }
+    /**
+     * Number of worker threads used by solve() if TBB is not
+     * available (with TBB, the task scheduler decides).
+     * 0 means one thread per hardware thread.
+     */
+    unsigned int threads() const { return _threads; }
+    void threads(unsigned int threads) { _threads = threads; }
+    /**
+     * Placement of the worker threads, see SchedulingPolicy.
+     */
+    SchedulingPolicy scheduling_policy() const { return _policy; }
+    void scheduling_policy(SchedulingPolicy policy) { _policy = policy; }
+    /**
+     * Bound on the memory of the tables that are alive at the same time,
+     * in bytes, 0 for no bound.  Once table_memory() reaches the budget,
+     * the scheduler no longer starts sibling subtrees in parallel, but
+     * completes them one after another, depth-first, so the tables of
+     * a subtree are freed before the next one is started.  The budget
+     * is soft, the subtrees already running are not interrupted.
+     */
+    size_t memory_budget() const { return _memory_budget; }
+    void memory_budget(size_t bytes) { _memory_budget = bytes; }
+    /**
+     * Memory of the tables that are completed, but not yet consumed by
+     * their parent.  0 if the solver does not keep track of its tables.
+     */
+    virtual size_t table_memory() const { return 0; }
+    bool memory_exhausted() const {
+        return _memory_budget > 0 && table_memory() >= _memory_budget;
+    }
     
     virtual void check_treedecomposition();
     virtual void work_on(const TreeDecomposition::vertex_descriptor& t);
@@ -56,13 +91,33 @@ public:
                          const TreeDecomposition::vertex_descriptor& right,
                          const TreeDecomposition::vertex_descriptor& t) = 0;
 
+    /**
+     * Estimated cost of the subtree rooted at t, available after
+     * pre_solve().  The scheduler starts the most expensive children
+     * first to shorten the critical path.
+     */
+    double subtree_cost(const TreeDecomposition::vertex_descriptor& t) const {
+        return _subtree_cost[t];
+    }
+
 protected:
     virtual void generate_treedecomposition();
     virtual void pre_solve();
     virtual void post_solve() = 0;
+    /**
+     * Estimated cost of the dynamic programming step at node t alone.
+     * The default assumes the work to be exponential in the bag width.
+     */
+    virtual double node_cost(const TreeDecomposition::vertex_descriptor& t) const;
 private:
+    void compute_subtree_costs();
+
     const LabeledGraph* _graph;
     TreeDecomposition* _treedecomposition;
+    unsigned int _threads;
+    SchedulingPolicy _policy;
+    size_t _memory_budget;
+    std::vector<double> _subtree_cost;
 };
 
 } // namespace
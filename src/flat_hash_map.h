@@ -0,0 +1,353 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_FLAT_HASH_MAP_H
+#define	SEQUOIA_FLAT_HASH_MAP_H
+
+#include "arena.h"
+#include "common.h"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#ifdef HAVE_TBB
+#include <tbb/atomic.h>
+#include <tbb/spin_rw_mutex.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <cassert>
+#include <stdint.h>
+#include <utility>
+
+namespace sequoia {
+
+/**
+ * An insert-only open-addressing hash map.
+ *
+ * The table consists of an array of control bytes and a parallel array
+ * of pointers to the entries.  The control bytes are organized in groups
+ * of 16 and hold 7 bits of each entry's hash, so a lookup usually
+ * compares a whole group at once (using SSE2 if available) and touches
+ * an entry only if its hash bits match.  Entries are allocated from an
+ * arena and never move, such that the entry pointers returned by find()
+ * and insert() remain valid while the map grows.  Iterators refer to
+ * positions in the table and are invalidated by growing.  Entries cannot
+ * be erased.
+ *
+ * When built with TBB, find() and insert() may be called concurrently.
+ * Slots are claimed with an atomic compare-and-swap on their control
+ * byte, lookups hold a shared lock and the map grows under an exclusive
+ * lock.  Iteration must not run concurrently with insert().
+ */
+template <typename Key, typename T, typename Hasher, typename Equals>
+class FlatHashMap {
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<const Key, T> value_type;
+    typedef size_t size_type;
+
+private:
+    static const size_t GROUP_SIZE = 16;
+    static const int8_t CTRL_EMPTY = -128;
+    static const int8_t CTRL_BUSY = -2;   // slot being claimed
+
+    template <typename V>
+    class Iterator : public boost::iterator_facade<
+        Iterator<V>, V, boost::forward_traversal_tag> {
+    public:
+        Iterator() : _map(NULL), _pos(0) { }
+        template <typename W> Iterator(const Iterator<W>& other)
+        : _map(other._map), _pos(other._pos) { }
+    private:
+        friend class boost::iterator_core_access;
+        friend class FlatHashMap;
+        template <typename W> friend class Iterator;
+        Iterator(const FlatHashMap* map, size_t pos) : _map(map), _pos(pos) {
+            skip();
+        }
+        void increment() { _pos++; skip(); }
+        template <typename W> bool equal(const Iterator<W>& other) const {
+            return _pos == other._pos;
+        }
+        V& dereference() const { return *_map->_slots[_pos]; }
+        void skip() {
+            while (_pos < _map->_capacity && _map->_ctrl[_pos] < 0)
+                _pos++;
+        }
+        const FlatHashMap* _map;
+        size_t _pos;
+    };
+
+public:
+    typedef Iterator<value_type> iterator;
+    typedef Iterator<const value_type> const_iterator;
+
+    /**
+     * @param arena the arena to allocate the entries from
+     */
+    explicit FlatHashMap(Arena* arena, const Hasher& hasher = Hasher(),
+                         const Equals& equals = Equals())
+    : _arena(arena), _hasher(hasher), _equals(equals),
+      _ctrl(NULL), _ctrl_storage(NULL), _slots(NULL), _capacity(0) {
+        _size = 0;
+        allocate(GROUP_SIZE);
+    }
+    ~FlatHashMap() {
+        // entries are released with the arena
+        delete[] _ctrl_storage;
+        delete[] _slots;
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, _capacity); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _capacity); }
+    size_type size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    /**
+     * Number of bytes of the control bytes and slots, which are not
+     * allocated from the arena (unlike the entries).
+     */
+    size_t allocated() const {
+        return _capacity * (sizeof(int8_t) + sizeof(value_type*)) + GROUP_SIZE;
+    }
+
+    /**
+     * @return the entry with key, NULL if there is none
+     */
+    value_type* find(const Key& key) {
+        return const_cast<value_type*>(static_cast<const FlatHashMap*>(this)->find(key));
+    }
+    const value_type* find(const Key& key) const {
+        size_t h = hash_of(key);
+#ifdef HAVE_TBB
+        RWMutex::scoped_lock lock(_mutex, false);
+#endif
+        size_t pos = lookup(key, h);
+        return pos == _capacity ? NULL : _slots[pos];
+    }
+
+    /**
+     * Insert value unless an entry with an equal key exists.
+     * @return the entry with value's key and whether it was inserted
+     */
+    std::pair<value_type*, bool> insert(const value_type& value) {
+        size_t h = hash_of(value.first);
+        value_type* entry = NULL;
+        for (;;) {
+            {
+#ifdef HAVE_TBB
+                RWMutex::scoped_lock lock(_mutex, false);
+#endif
+                size_t pos = lookup(value.first, h);
+                if (pos != _capacity)
+                    return std::make_pair(_slots[pos], false);
+                // reserve room for the entry, stay below 7/8 load
+                if (++_size * 8 <= _capacity * 7) {
+                    if (entry == NULL)
+                        entry = new (_arena->allocate(sizeof(value_type),
+                                                      __alignof__(value_type)))
+                            value_type(value);
+                    bool inserted;
+                    pos = claim(entry, h, inserted);
+                    if (!inserted)
+                        _size--;
+                    // read the slot before releasing the lock, the map may grow
+                    return std::make_pair(_slots[pos], inserted);
+                }
+                _size--;
+            }
+            grow();
+        }
+    }
+
+private:
+    FlatHashMap(const FlatHashMap&);
+    FlatHashMap& operator=(const FlatHashMap&);
+
+    size_t hash_of(const Key& key) const {
+        // spread the bits, we use the low ones for the control bytes
+        // and the higher ones to select the group
+        size_t h = _hasher(key) * static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+        return h ^ (h >> 29);
+    }
+    static int8_t tag_of(size_t h) { return static_cast<int8_t>(h & 0x7F); }
+    size_t group_of(size_t h) const { return (h >> 7) & (_capacity / GROUP_SIZE - 1); }
+
+    static int8_t load_ctrl(const int8_t* c) {
+#ifdef HAVE_TBB
+        return __atomic_load_n(c, __ATOMIC_ACQUIRE);
+#else
+        return *c;
+#endif
+    }
+
+    /**
+     * Bit masks of the slots in the group starting at ctrl that carry tag
+     * resp. that are empty.
+     */
+    static void match(const int8_t* ctrl, int8_t tag,
+                      unsigned int& tags, unsigned int& empties) {
+#ifdef __SSE2__
+        __m128i group = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+        tags = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+        empties = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(CTRL_EMPTY)));
+#else
+        tags = empties = 0;
+        for (unsigned int i = 0; i < GROUP_SIZE; i++) {
+            if (ctrl[i] == tag) tags |= 1U << i;
+            else if (ctrl[i] == CTRL_EMPTY) empties |= 1U << i;
+        }
+#endif
+    }
+
+    /**
+     * @return position of the entry with key, or _capacity if none
+     */
+    size_t lookup(const Key& key, size_t h) const {
+        int8_t tag = tag_of(h);
+        size_t mask = _capacity / GROUP_SIZE - 1;
+        size_t g = group_of(h);
+        for (size_t step = 1; ; step++) {
+            const int8_t* ctrl = _ctrl + g * GROUP_SIZE;
+            unsigned int tags, empties;
+            match(ctrl, tag, tags, empties);
+            while (tags != 0) {
+                unsigned int i = __builtin_ctz(tags);
+                size_t pos = g * GROUP_SIZE + i;
+                if (load_ctrl(_ctrl + pos) == tag && _equals(_slots[pos]->first, key))
+                    return pos;
+                tags &= tags - 1;
+            }
+            if (empties != 0)
+                return _capacity;
+            g = (g + step) & mask; // triangular probing visits all groups
+        }
+    }
+
+    /**
+     * Store entry in the first empty slot of its probe sequence, unless
+     * an entry with an equal key is found before.
+     * @return the position of the entry with entry's key
+     */
+    size_t claim(value_type* entry, size_t h, bool& inserted) {
+        int8_t tag = tag_of(h);
+        size_t mask = _capacity / GROUP_SIZE - 1;
+        size_t g = group_of(h);
+        for (size_t step = 1; ; step++) {
+            for (size_t pos = g * GROUP_SIZE; pos < (g + 1) * GROUP_SIZE; pos++) {
+                int8_t c = load_ctrl(_ctrl + pos);
+#ifdef HAVE_TBB
+                while (c == CTRL_BUSY || c == CTRL_EMPTY) {
+                    if (c == CTRL_BUSY) { // wait for the other thread to finish
+                        c = load_ctrl(_ctrl + pos);
+                        continue;
+                    }
+                    int8_t expected = CTRL_EMPTY;
+                    if (__atomic_compare_exchange_n(_ctrl + pos, &expected, CTRL_BUSY,
+                                                    false, __ATOMIC_ACQ_REL,
+                                                    __ATOMIC_ACQUIRE)) {
+                        _slots[pos] = entry;
+                        __atomic_store_n(_ctrl + pos, tag, __ATOMIC_RELEASE);
+                        inserted = true;
+                        return pos;
+                    }
+                    c = expected;
+                }
+#else
+                if (c == CTRL_EMPTY) {
+                    _slots[pos] = entry;
+                    _ctrl[pos] = tag;
+                    inserted = true;
+                    return pos;
+                }
+#endif
+                if (c == tag && _equals(_slots[pos]->first, entry->first)) {
+                    inserted = false;
+                    return pos;
+                }
+            }
+            g = (g + step) & mask;
+        }
+    }
+
+    void allocate(size_t capacity) {
+        assert(capacity % GROUP_SIZE == 0);
+        assert((capacity & (capacity - 1)) == 0);
+        _capacity = capacity;
+        _ctrl = new int8_t[capacity + GROUP_SIZE];
+        // align the groups for SSE2 loads
+        _ctrl_storage = _ctrl;
+        _ctrl = reinterpret_cast<int8_t*>(
+            (reinterpret_cast<uintptr_t>(_ctrl) + GROUP_SIZE - 1) & ~(GROUP_SIZE - 1));
+        for (size_t i = 0; i < capacity; i++)
+            _ctrl[i] = CTRL_EMPTY;
+        _slots = new value_type*[capacity];
+    }
+
+    /**
+     * Double the capacity if the map is (still) full.
+     */
+    void grow() {
+#ifdef HAVE_TBB
+        RWMutex::scoped_lock lock(_mutex, true);
+#endif
+        if ((_size + 1) * 8 <= _capacity * 7)
+            return; // someone else was faster
+        int8_t* old_ctrl = _ctrl;
+        int8_t* old_storage = _ctrl_storage;
+        value_type** old_slots = _slots;
+        size_t old_capacity = _capacity;
+        allocate(2 * old_capacity);
+        for (size_t pos = 0; pos < old_capacity; pos++) {
+            if (old_ctrl[pos] < 0)
+                continue;
+            bool inserted;
+            claim(old_slots[pos], hash_of(old_slots[pos]->first), inserted);
+            assert(inserted);
+        }
+        delete[] old_storage;
+        delete[] old_slots;
+    }
+
+    Arena* _arena;
+    Hasher _hasher;
+    Equals _equals;
+    int8_t* _ctrl;
+    int8_t* _ctrl_storage; // unaligned allocation of _ctrl
+    value_type** _slots;
+    size_t _capacity;
+#ifdef HAVE_TBB
+    typedef tbb::spin_rw_mutex RWMutex;
+    mutable RWMutex _mutex;
+    tbb::atomic<size_t> _size;
+#else
+    size_t _size;
+#endif
+};
+
+} // namespace
+
+#endif	/* SEQUOIA_FLAT_HASH_MAP_H */
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "flyweight.h"
+
+#include <vector>
+
+namespace sequoia {
+
+namespace internal {
+
+// Only changed while no flyweights are created or destroyed
+// concurrently, i.e., outside of the dynamic programming.
+bool flyweight_deferred = false;
+
+namespace {
+
+typedef void (*CollectFunction)(bool all);
+
+struct flyweight_registry_t {
+#ifdef HAVE_TBB
+    typedef tbb::queuing_rw_mutex Mutex;
+#else
+    typedef std::mutex Mutex;
+#endif
+    std::vector<CollectFunction> collectors;
+    Mutex mutex;
+};
+
+flyweight_registry_t& flyweight_registry() {
+    static flyweight_registry_t instance;
+    return instance;
+}
+
+} // namespace
+
+void flyweight_register_pool(CollectFunction collect) {
+    flyweight_registry_t& registry = flyweight_registry();
+#ifdef HAVE_TBB
+    flyweight_registry_t::Mutex::scoped_lock lock(registry.mutex, true);
+#else
+    std::lock_guard<flyweight_registry_t::Mutex> lock(registry.mutex);
+#endif
+    registry.collectors.push_back(collect);
+}
+
+} // namespace internal
+
+void flyweight_deferred_reclamation(bool deferred) {
+    internal::flyweight_deferred = deferred;
+}
+
+bool flyweight_deferred_reclamation() {
+    return internal::flyweight_deferred;
+}
+
+void flyweight_collect(bool all) {
+    internal::flyweight_registry_t& registry = internal::flyweight_registry();
+    std::vector<internal::CollectFunction> collectors;
+    {
+#ifdef HAVE_TBB
+	internal::flyweight_registry_t::Mutex::scoped_lock lock(registry.mutex, false);
+#else
+	std::lock_guard<internal::flyweight_registry_t::Mutex> lock(registry.mutex);
+#endif
+	collectors = registry.collectors;
+    }
+    for (unsigned int i = 0; i < collectors.size(); i++)
+	collectors[i](all);
+}
+
+} // namespace
@@ -28,140 +28,279 @@
 #ifdef HAVE_TBB
 #include <tbb/atomic.h>
 #include <tbb/queuing_rw_mutex.h>
+#else
+#include <atomic>
+#include <mutex>
 #endif
 
+#include <vector>
+
 namespace sequoia {
 
 /**
- * An implementation of the flyweight pattern.
+ * Reclamation of unreferenced flyweights.  By default, an entry is
+ * removed from its pool as soon as its last reference is destroyed,
+ * which requires the pool's write lock in every destructor.
+ *
+ * With deferred reclamation, destructors only decrement the reference
+ * count.  Unreferenced entries stay in the pool, where they may be
+ * revived by a constructor, until flyweight_collect() removes them in
+ * bulk.
  */
-template <typename Type> class Flyweight {
+void flyweight_deferred_reclamation(bool deferred);
+bool flyweight_deferred_reclamation();
+
+/**
+ * Remove unreferenced entries from all flyweight pools.  Unless all is
+ * set, only shards in which a considerable fraction of the entries is
+ * unreferenced are swept.
+ */
+void flyweight_collect(bool all = false);
+
+namespace internal {
+extern bool flyweight_deferred;
+void flyweight_register_pool(void (*collect)(bool all));
+} // namespace internal
+
+template <typename Type> class Flyweight;
+template <typename Entry> class FlyweightInheritance;
+
+/**
+ * Base class of all objects stored in a flyweight pool.  Carries the
+ * object's reference count and the function that releases a reference
+ * to it, which also identifies the pool (and thus the dynamic type) the
+ * object belongs to.  Handles therefore only need a single pointer to
+ * the pooled object.
+ */
+class FlyweightObject {
+protected:
+    FlyweightObject() : _release(NULL) { _refs = 0; }
+    // copies are new objects not (yet) in any pool
+    FlyweightObject(const FlyweightObject&) : _release(NULL) { _refs = 0; }
+    FlyweightObject& operator=(const FlyweightObject&) { return *this; }
+    ~FlyweightObject() { }
 private:
-    // Storing pairs is much faster than storing pointers to pairs (up to 10% speedup)
+    template <typename Type> friend class Flyweight;
+    template <typename Entry> friend class FlyweightInheritance;
 #ifdef HAVE_TBB
     typedef tbb::atomic<size_t> Counter;
 #else
-    typedef size_t Counter;
+    typedef std::atomic<size_t> Counter;
 #endif
-    typedef std::pair<const Type*, Counter*> Entry;
+    mutable Counter _refs;
+    mutable void (*_release)(const FlyweightObject* object);
+};
+
+/**
+ * An implementation of the flyweight pattern.  Type must extend
+ * FlyweightObject.
+ *
+ * The pool is split into 2^FLYWEIGHT_POOL_SHARD_BITS hash-partitioned
+ * shards with a lock each, such that creating and destroying flyweights
+ * in different threads rarely contends for the same lock.
+ * See flyweight_deferred_reclamation() for when entries are removed.
+ */
+template <typename Type> class Flyweight {
+private:
     struct Hasher {
-        size_t operator()(const Entry& in) const {
-            assert(in.first != NULL);
-	    assert(in.first->hash() != 0);
-            return in.first->hash();
+        size_t operator()(const Type* in) const {
+            assert(in != NULL);
+	    assert(in->hash() != 0);
+            return in->hash();
         }
     };
     struct Equals {
-        size_t operator()(const Entry& e1, const Entry& e2) const {
-#if 0
-            // should not happen
-	    if (e1.first == NULL && e2.first == NULL) return true; 
-#else
-	    assert(!(e1.first == NULL && e2.first == NULL));
-#endif
-            return *e1.first == *e2.first;
+        size_t operator()(const Type* e1, const Type* e2) const {
+	    assert(e1 != NULL && e2 != NULL);
+            return *e1 == *e2;
         }
     };
-    typedef SEQUOIA_CONCUR_UNORDERED_SET<Entry, Hasher, Equals> Pool;
+    typedef SEQUOIA_CONCUR_UNORDERED_SET<const Type*, Hasher, Equals> Pool;
 public:
-    typedef const Entry* Handle;
-    Flyweight<Type>(const Type* entry) {
-        Counter *count = new Counter(); // TBB requires default initialization first
-	*count = 1UL;
-        Entry p(entry, count);
+    Flyweight<Type>(const Type* entry) : _object(intern(entry)) { }
+    Flyweight<Type>(const Flyweight& other) : _object(other._object) {
+        // having another instanciated object (other) means there is
+	// at least ONE other object in THIS thread referencing 
+	// THIS instance.  This means, in any other threads,
+	// the coutner is ALWAYS > 0 and we will NOT remove
+	// the flyweight from the pool.  We therefore
+	// do not need to aquire a global lock, but can rely
+	// on the atomic counter to increase this counter.
+        _object->_refs++;
+    }
+    ~Flyweight<Type>() { release(_object); }
+    const Type* get() const { return _object; }
+    bool operator==(const Flyweight<Type>& other) const {
+        return _object == other._object;
+    }
+    bool operator!=(const Flyweight<Type>& other) const {
+        return _object != other._object;
+    }
+    const Flyweight<Type>* clone() const {
+        return new Flyweight(*this);
+    }
+    /**
+     * Store entry in the pool, unless an equal object exists already,
+     * in which case entry is deleted.
+     * @return the pooled object, with one reference owned by the caller
+     */
+    static const Type* intern(const Type* entry) {
+        Shard& shard = shard_of(entry);
 #ifdef HAVE_TBB
-	Mutex::scoped_lock lock(mutex()); // allow multiple "readers".  Only unsafe_erase() must be write-locked
+	Mutex::scoped_lock lock(shard.mutex); // allow multiple "readers".  Only unsafe_erase() must be write-locked
+#else
+	std::unique_lock<Mutex> lock(shard.mutex);
 #endif
-        std::pair<typename Pool::iterator, bool> res = pool().insert(p);
-        _handle = &(*res.first);
+        entry->_refs = 1;
+        entry->_release = &Flyweight<Type>::release_object;
+        std::pair<typename Pool::iterator, bool> res = shard.pool.insert(entry);
+        const Type* object = *res.first;
+        if (res.second)
+            shard.entries++;
         if (!res.second) { // already existing
 #ifdef FLYWEIGHT_DEBUG
 	    DPRINTLN("[Flyweight<" << typeid(Type).name() << "> new " << entry
-		    << "- exists already at " << _handle->first 
-		    << " => " << *_handle->second << "]");
+		    << "- exists already at " << object
+		    << " => " << object->_refs << "]");
 #endif
-            // increase number of references only
-            (*_handle->second)++;
+            // increase number of references only, possibly reviving
+	    // an unreferenced entry awaiting collection
+            if (object->_refs++ == 0)
+                shard.unreferenced--;
 #ifdef HAVE_TBB
 	    lock.release();
+#else
+	    lock.unlock();
 #endif
-            // delete temporary allocated memory
-            delete count;
             // free the entry we were supposed to store
             delete entry;
         }
 #ifdef FLYWEIGHT_DEBUG
-        DPRINTLN("[Flyweight<" << typeid(Type).name() << "> new " << _handle->first
-                << " => " << *_handle->second << "]");
-#endif
-    };
-    Flyweight<Type>(const Flyweight& other) {
-        // having another instanciated object (other) means there is
-	// at least ONE other object in THIS thread referencing 
-	// THIS instance.  This means, in any other threads,
-	// the coutner is ALWAYS > 0 and we will NOT remove
-	// the flyweight from the pool.  We therefore
-	// do not need to aquire a global lock, but can rely
-	// on the atomic counter to increase this counter.
-        _handle = other._handle;
-        (*_handle->second)++;
-#ifdef FLYWEIGHT_DEBUG
-        DPRINTLN("[Flyweight<" << typeid(Type).name() << "> copy "
-                << _handle->first << " => " << *_handle->second << "]");
+        DPRINTLN("[Flyweight<" << typeid(Type).name() << "> new " << object
+                << " => " << object->_refs << "]");
 #endif
+        return object;
     }
-    ~Flyweight<Type>() {
-        assert(*_handle->second > 0);
+    /**
+     * Drop one reference to the pooled object, removing it from the
+     * pool (or marking it for collection) if it was the last one.
+     */
+    static void release(const Type* object) {
+        assert(object->_refs > 0);
 #ifdef FLYWEIGHT_DEBUG
         DPRINTLN("[Flyweight<" << typeid(Type).name() << "> destroy "
-                << _handle->first << " => " << *_handle->second << "]");
+                << object << " => " << object->_refs << "]");
 #endif
+        Shard& shard = shard_of(object);
+        if (internal::flyweight_deferred) {
+            // the entry is removed in flyweight_collect().  We must not
+            // touch it after the decrement, it may be collected anytime.
+            if (--object->_refs == 0)
+                shard.unreferenced++;
+            return;
+        }
 #ifdef HAVE_TBB
-	Mutex::scoped_lock lock(mutex(), true); // acquire write lock
+	Mutex::scoped_lock lock(shard.mutex, true); // acquire write lock
+#else
+	std::unique_lock<Mutex> lock(shard.mutex);
 #endif
-        (*_handle->second)--;
-        if (*_handle->second == 0) {
-            const Type* e = _handle->first;
-            Counter * c = _handle->second;
+        if (--object->_refs == 0) {
 #ifdef HAVE_TBB
-            pool().unsafe_erase(*_handle);
+            shard.pool.unsafe_erase(object);
+            shard.entries--;
 	    lock.release(); // release before deletion
 #else
-            pool().erase(*_handle);
+            shard.pool.erase(object);
+            shard.entries--;
+	    lock.unlock();
 #endif
-            delete e;
-            delete c;
+            delete object;
         }
     }
-    const Type* get() const { return _handle->first; }
-    bool operator==(const Flyweight<Type>& other) const {
-        return _handle->first == other._handle->first;
-    }
-    bool operator!=(const Flyweight<Type>& other) const {
-        return _handle->first != other._handle->first;
-    }
-    const Flyweight<Type>* clone() const {
-        return new Flyweight(*this);
+    /**
+     * @see flyweight_collect()
+     */
+    static void collect(bool all) {
+        Shard* shards = static_holder_class::shards();
+        for (unsigned int i = 0; i < (1U << FLYWEIGHT_POOL_SHARD_BITS); i++) {
+            Shard& shard = shards[i];
+            long unreferenced = shard.unreferenced;
+            if (unreferenced <= 0)
+                continue;
+            // the pool itself must not be inspected without the lock
+            if (!all && unreferenced * 4 < shard.entries)
+                continue;
+            std::vector<const Type*> garbage;
+            {
+#ifdef HAVE_TBB
+                Mutex::scoped_lock lock(shard.mutex, true); // acquire write lock
+#else
+                std::lock_guard<Mutex> lock(shard.mutex);
+#endif
+                typename Pool::const_iterator it = shard.pool.begin();
+                typename Pool::const_iterator itend = shard.pool.end();
+                for (; it != itend; ++it)
+                    if ((*it)->_refs == 0)
+                        garbage.push_back(*it);
+                for (unsigned int j = 0; j < garbage.size(); j++) {
+#ifdef HAVE_TBB
+                    shard.pool.unsafe_erase(garbage[j]);
+#else
+                    shard.pool.erase(garbage[j]);
+#endif
+                }
+                shard.unreferenced -= garbage.size();
+                shard.entries -= garbage.size();
+            }
+            for (unsigned int j = 0; j < garbage.size(); j++)
+                delete garbage[j];
+        }
     }
 private:
-    Handle _handle;
+    static void release_object(const FlyweightObject* object) {
+        release(static_cast<const Type*>(object));
+    }
+    const Type* _object;
 #ifdef HAVE_TBB
     typedef tbb::queuing_rw_mutex Mutex;
-    Mutex& mutex() { return static_holder_class::mutex(); }
+#else
+    typedef std::mutex Mutex;
 #endif
-    Pool& pool() { return static_holder_class::get(); }
+#ifdef HAVE_TBB
+    typedef tbb::atomic<long> Counter;
+#else
+    typedef std::atomic<long> Counter;
+#endif
+    struct Shard {
+        Shard() { unreferenced = 0; entries = 0; }
+        Pool pool;
+        Mutex mutex;
+        // estimated number of unreferenced entries (deferred reclamation)
+        Counter unreferenced;
+        // number of entries in the pool, readable without the lock
+        Counter entries;
+    };
+    /**
+     * The shard responsible for entry.  We use the high-order bits of
+     * the (mixed) hash, the pools themselves use the low-order ones.
+     */
+    static Shard& shard_of(const Type* entry) {
+        size_t h = entry->hash() * static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+        return static_holder_class::shards()[
+            h >> (sizeof(size_t) * CHAR_BIT - FLYWEIGHT_POOL_SHARD_BITS)];
+    }
     // returns singleton instances
     struct static_holder_class {
-	static Pool & get() {
-	    static Pool instance; 
+	static Shard* shards() {
+	    static Shard instance[1 << FLYWEIGHT_POOL_SHARD_BITS];
+	    static bool registered = register_pool();
+	    (void)registered;
 	    return instance;
 	}
-#ifdef HAVE_TBB
-	static Mutex& mutex() {
-	    static Mutex instance;
-	    return instance;
+	static bool register_pool() {
+	    internal::flyweight_register_pool(&Flyweight<Type>::collect);
+	    return true;
 	}
-#endif
     }; 
 };
 
@@ -22,132 +22,70 @@
 #ifndef SEQUOIA_FLYWEIGHT_INHERITANCE_H
 #define SEQUOIA_FLYWEIGHT_INHERITANCE_H
 
-/*
- * Enable USE_BOOST to use boost's flyweight implementation.
- * Beware!  Will most definitely crash on program's exit (but the solving
- * works fine).
- */
-//#define USE_BOOST
-
 #include "hashing.h"
-
-#ifndef USE_BOOST
 #include "flyweight.h"
-#else
-#include <boost/flyweight/flyweight.hpp>
-#include <boost/flyweight/hashed_factory.hpp>
-#include <boost/flyweight/static_holder.hpp>
-#include <boost/flyweight/intermodule_holder.hpp> // test for static
-#include <boost/flyweight/simple_locking.hpp>
-#include <boost/flyweight/no_locking.hpp>
-#include <boost/flyweight/refcounted.hpp>
-#include <boost/shared_ptr.hpp>
-#endif
 
 namespace sequoia {
-    
-template <typename Base> class FlyweightBase {
-public:
-    virtual ~FlyweightBase<Base>() { }
-    virtual const Base* get() const = 0;
-    virtual const FlyweightBase<Base>* clone() const = 0;
-};
-
-template <typename Base, typename Derived> class FlyweightDerived : public FlyweightBase<Base> {
-public:
-    FlyweightDerived<Base, Derived>(const Derived* entry) : _flyweight(entry) { }
-    FlyweightDerived<Base, Derived>(const FlyweightDerived<Base, Derived>& other) :
-        _flyweight(other._flyweight) { }
-    virtual ~FlyweightDerived<Base, Derived>() { }
-    virtual const FlyweightDerived<Base, Derived>* clone() const {
-        return new FlyweightDerived<Base, Derived>(*this);
-    }
-
-#ifndef USE_BOOST
-private:
-    virtual const Base* get() const { return _flyweight.get(); }
-    Flyweight<Derived> _flyweight;
-#else
-    virtual const Base* get() const { return _flyweight.get().get(); }
-    /*
-     * We need to use an (shared_ptr) holder object, because the pointer to
-     * Derived must be detroyed when the refcount becomes 0.
-     */
-    typedef boost::shared_ptr<const Derived> ptr_holder;
-    struct my_equals {
-        size_t operator()(const ptr_holder& p1, const ptr_holder& p2) const {
-            if (p1.get() == p2.get()) return true;
-            if (p1.get() == NULL || p2.get() == NULL) return false;
-            return *p1 == *p2;
-        }
-    };
-    struct my_hasher {
-        size_t operator()(const ptr_holder& in) const {
-            ptr_deep_hasher<Derived> h;
-            return h(in.get());
-        }
-    };
-private:
-    typedef boost::flyweight<ptr_holder,
-        boost::flyweights::hashed_factory<my_hasher, my_equals>,
-        boost::flyweights::intermodule_holder,
-#if 1
-        boost::flyweights::simple_locking,
-#else
-	boost::flyweights::no_locking,
-#endif
-        boost::flyweights::refcounted> FlyweightImpl;
-    FlyweightImpl _flyweight;
-#endif
-};
-
 
 /**
  * An implementation of the flyweight pattern that allows for inheritance.
- * This is achieved by using a wrapper class (FlyweightInheritance)
- * that only stores pointers to the implementation flyweights.
- * The actual implementation extends FlyweightBase in a concrete
- * implementation FlyweightDerived.
+ * The objects of the derived classes are stored in per-type pools
+ * (Flyweight<Derived>), a FlyweightInheritance handle only holds a
+ * pointer to the pooled object.  Entry must extend FlyweightObject,
+ * which carries the reference count and the pool to release the
+ * object to.
  */
 template <typename Entry> class FlyweightInheritance {
 public:
-    FlyweightInheritance() : _wrapper(NULL) { }
-    FlyweightInheritance(const FlyweightInheritance& other) : _wrapper(NULL) {
-        if (other._wrapper != NULL)
-            _wrapper = other._wrapper->clone();
+    FlyweightInheritance() : _object(NULL) { }
+    FlyweightInheritance(const FlyweightInheritance& other) : _object(other._object) {
+        if (_object != NULL)
+            _object->_refs++;
     }
-    FlyweightInheritance(const FlyweightBase<Entry>* wrapper) : _wrapper(wrapper) { }
+    /**
+     * Adopt a reference to the pooled object obtained from
+     * Flyweight<Derived>::intern().
+     */
+    explicit FlyweightInheritance(const Entry* object) : _object(object) { }
     ~FlyweightInheritance() {
-        delete _wrapper;
+        if (_object != NULL)
+            _object->_release(_object);
     }
     const Entry* get() const {
-        assert(_wrapper != NULL);
-        return _wrapper->get();
+        assert(_object != NULL);
+        return _object;
     }
+    /* The flyweight pattern guarantees that the underlying objects
+     * are equal if and only if their pointer addresses are equal */
     bool operator==(const FlyweightInheritance& other) const {
-        if (_wrapper == other._wrapper) return true;
-        if (_wrapper == NULL || other._wrapper == NULL) return false;
-        /* The flyweight pattern guarantees that the underlying objects
-         * are equal if and only if their pointer addresses are equal */
-        return _wrapper->get() == other._wrapper->get();
+        return _object == other._object;
     }
     bool operator!=(const FlyweightInheritance& other) const {
-        return !(*this == other);
+        return _object != other._object;
     }
     FlyweightInheritance& operator=(const FlyweightInheritance& other) {
-        assert(other._wrapper != NULL);
-        assert(_wrapper == NULL); // if this fails, run delete on wrapper.
-        if (this != &other) 
-            _wrapper = other._wrapper->clone();
+        assert(other._object != NULL);
+        assert(_object == NULL); // if this fails, release the old object.
+        if (this != &other) {
+            _object = other._object;
+            _object->_refs++;
+        }
         return *this;
     }
     const FlyweightInheritance<Entry>* clone() const {
         return new FlyweightInheritance<Entry>(*this);
     }
+    /**
+     * Exchange the referenced objects without touching the reference
+     * counts.
+     */
+    void swap(FlyweightInheritance& other) {
+        const Entry* tmp = _object;
+        _object = other._object;
+        other._object = tmp;
+    }
 private:
-    /* Use a direct pointer.  Using boost::shared_ptr will decrease performance
-     * by roughly 10% */
-    const FlyweightBase<Entry>* _wrapper;
+    const Entry* _object;
 };
 
 template <typename T, typename H = hash_func_hasher<T> >
@@ -159,13 +97,50 @@ struct flyweight_inheritance_deep_hasher {
     }
 };
 
+/**
+ * Hash value of a flyweight for use in containers.  Equal flyweights
+ * share the pooled object, so unless FLYWEIGHT_IDENTITY_HASHING is
+ * disabled, we hash its (mixed) address and need not touch the object.
+ * Use the object's hash() where the value must not depend on the
+ * memory layout, e.g., for hashing the object containing the flyweight.
+ */
+template <typename T> inline size_t flyweight_hash(const FlyweightInheritance<T>& f) {
+#if FLYWEIGHT_IDENTITY_HASHING
+    size_t h = reinterpret_cast<size_t>(f.get()) * static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+    return h ^ (h >> 32);
+#else
+    return f.get()->hash();
+#endif
+}
+
+/**
+ * Hash a pointer to a flyweight, see flyweight_hash().
+ */
+template <typename T> struct flyweight_ptr_hasher {
+    size_t operator()(const FlyweightInheritance<T>* in) const {
+        if (in == NULL) return 1UL;
+        return flyweight_hash(*in);
+    }
+};
+
+/**
+ * Compare two pointers to flyweights by the pooled objects' addresses.
+ */
+template <typename T> struct flyweight_ptr_equals {
+    bool operator()(const FlyweightInheritance<T>* p1,
+                    const FlyweightInheritance<T>* p2) const {
+        if (p1 == p2) return true;
+        if (p1 == NULL || p2 == NULL) return false;
+        return *p1 == *p2;
+    }
+};
+
 template <typename T> struct FlyweightInheritanceFactory {
     template<typename D> static FlyweightInheritance<T> make_static(const D* obj) {
-        //FlyweightDerived<T, D>::FlyweightImpl::init();
-        return FlyweightInheritance<T>(new FlyweightDerived<T, D>(obj));
+        return FlyweightInheritance<T>(Flyweight<D>::intern(obj));
     }
     template<typename D> static const FlyweightInheritance<T>* make(const D* obj) {
-        return new FlyweightInheritance<T>(new FlyweightDerived<T, D>(obj));
+        return new FlyweightInheritance<T>(Flyweight<D>::intern(obj));
     }
 };
 
@@ -33,7 +33,7 @@ class MCGame;
 typedef FlyweightInheritance<MCGame> MCGame_f;
 typedef FlyweightInheritanceFactory<MCGame> MCGameFlyFactory;
 
-class MCGame {
+class MCGame : public FlyweightObject {
 public:
     enum Player { FALSIFIER = 0, VERIFIER, UNDETERMINED }; // order is important
     template <MCGame::Player> struct opponent {
@@ -35,8 +35,8 @@ const MCGame_f* AtomarUndetGame::convert() const {
 /*
  * Offload these to AtomarGameFactory to evaluate the atomic formula
  * based on the given alpha.
- * Caching is probably not worthwhile here, since the atomar evaluation
- * itself is cheap.
+ * Caching is not worthwhile here, since the atomar evaluation itself is
+ * cheap and the resulting games are shared by the factory.
  */
 const MCGame_f* AtomarUndetGame::forget(const ConstantSymbol* tsym,
 					int signature_depth,
@@ -100,7 +100,8 @@ const MCGame_f* BoolCombUndetGame<TFormula, _player>::forget(const ConstantSymbo
         DEBUG(tab_prefix(level()) << "(" << subf->toString() << "):" << std::endl);
 
 #if USE_CACHE_SUBGAMES
-        const MCGame_f* sub = cache_forget_lookup(subf, alpha, subg, tsym);
+        CachePin<CacheForgetValue> cached = cache_forget_lookup(subf, alpha, subg, tsym);
+        const MCGame_f* sub = cached.empty() ? NULL : cached->clone();
 #else
 	const MCGame_f *sub = NULL;
 #endif
@@ -136,17 +137,16 @@ const MCGame_f* BoolCombUndetGame<TFormula, _player>::introduce(const ConstantSy
         DEBUG(tab_prefix(level()) << "(" << subf->toString() << "):" << std::endl);
 
 #if USE_CACHE_SUBGAMES
-        const CacheIntroduceValue* cached = cache_introduce_lookup(subf, alpha, subg, tsym);
-        if (cached == NULL) {
-            CacheIntroduceValue *res = new CacheIntroduceValue();
-            const MCGame_f *sub = subg->get()->introduce(tsym, signature_depth, alpha);
-	    res->add(alpha->clone(), sub);
-            cache_introduce_store(subf, alpha, subg, tsym, res);
-            cached = res;
+        CachePin<CacheIntroduceValue> cached = cache_introduce_lookup(subf, alpha, subg, tsym);
+        const MCGame_f *sub;
+        if (!cached.empty()) {
+            sub = cached->begin()->second->clone();
+        } else {
+            sub = subg->get()->introduce(tsym, signature_depth, alpha);
+            CacheIntroduceValue res;
+	    res.add(alpha->clone(), sub->clone());
+            cache_introduce_store(subf, alpha, subg, tsym, &res);
         }
-        typename CacheIntroduceValue::const_iterator it = cached->begin();
-        const MCGame_f *sub = it->second->clone();
-        delete cached;
 #else
         const MCGame_f *sub = subg->get()->introduce(tsym, signature_depth, alpha);
 #endif
@@ -189,7 +189,8 @@ const MCGame_f* BoolCombUndetGame<TFormula, _player>::join(const MCGame_f* other
         DEBUG(tab_prefix(level()) << "(" << subf->toString() << "):" << std::endl);
 	
 #if USE_CACHE_SUBGAMES
-	const MCGame_f *sub = cache_join_lookup(subf, alpha, subg, subother);
+	CachePin<CacheJoinValue> cached = cache_join_lookup(subf, alpha, subg, subother);
+	const MCGame_f *sub = cached.empty() ? NULL : cached->clone();
 #else
 	const MCGame_f *sub = NULL;
 #endif
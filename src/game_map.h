@@ -23,104 +23,204 @@
 #define SEQUOIA_GAME_MAP_H
 
 #include "game.h"
-#include "game_set.h"
-#include "unordered_defs.h"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace sequoia {
 
 /**
- * Provides a container that for each TMove flyweight (template
- * parameter TMove expected to be one of SetMove/PointMove) holds
- * a set of MCGame flyweights.
- * 
+ * Provides a container that for each TMove (template parameter TMove
+ * expected to be one of SetMove/PointMove, pooled in the moves_pool)
+ * holds a set of MCGame flyweights.
+ *
+ * While a game is built, insert() only collects the pairs.  pack() sorts
+ * them, drops duplicates and stores them in a single array, ordered by
+ * the moves and, for each move, by the games.  Moves are pooled and games
+ * are flyweights, so two packed containers hold the same subgames if and
+ * only if their arrays hold the same pointers, and the flyweight pool of
+ * the games serves as hash-consing table.  The packed container must not
+ * be modified anymore.
+ *
  * Does NOT clone the flyweights upon insertion for efficiency reasons (new
  * is too expensive).  Instead, it takes care of destruction of
- * this flyweight (either on insertion [duplicate entries] or on destruction).
+ * this flyweight (either on packing [duplicate entries] or on destruction).
  * Make sure the flyweight pointer inserted is not deleted elsewhere!
  */
-template <typename Key, typename Hasher, typename Equals = std::equal_to<Key> >
+template <typename TMove>
 class GameMap {
-    typedef SEQUOIA_UNORDERED_MAP<
-        Key,
-	MCGameSet *,
-	Hasher,
-	Equals
-    > Container;
-    typedef MCGameSet SubgamesContainer;
+    struct Entry {
+	const TMove *move;
+	MCGame_f game;
+    };
+    typedef std::pair<const TMove*, const MCGame_f*> Pending;
 public:
-    typedef typename Container::const_iterator const_iterator;
-    typedef typename SubgamesContainer::const_iterator const_subgames_iterator;
-    const_iterator find(const Key& key) const { return _container.find(key); }
-    const_iterator begin() const { return _container.begin(); }
-    const_iterator end() const { return _container.end(); }
-    const_subgames_iterator games_begin(const const_iterator &it) const {
-        assert(it->second != NULL);
-        return it->second->begin();
+    /**
+     * Order of the moves in the packed array.  Deterministic except for
+     * hash collisions, such that serialized games do not depend on the
+     * memory layout of the run.
+     */
+    static bool move_less(const TMove* m1, const TMove* m2) {
+	if (m1 == m2) return false;
+	size_t h1 = move_hash(m1), h2 = move_hash(m2);
+	if (h1 != h2) return h1 < h2;
+	return m1 < m2;
+    }
+
+    /**
+     * Iterates over the games of one move.
+     */
+    class const_subgames_iterator : public boost::iterator_facade<const_subgames_iterator,
+	const MCGame_f* const, boost::forward_traversal_tag, const MCGame_f*> {
+    public:
+	const_subgames_iterator() : _entry(NULL) { }
+    private:
+	friend class GameMap;
+	friend class boost::iterator_core_access;
+	explicit const_subgames_iterator(const Entry *entry) : _entry(entry) { }
+	const MCGame_f* dereference() const { return &_entry->game; }
+	bool equal(const const_subgames_iterator &other) const { return _entry == other._entry; }
+	void increment() { ++_entry; }
+	const Entry *_entry;
+    };
+
+    /**
+     * Iterates over the moves.
+     */
+    class const_iterator {
+    public:
+	const_iterator() : _first(NULL), _end(NULL) { }
+	const TMove* move() const { return _first->move; }
+	const_subgames_iterator games_begin() const { return const_subgames_iterator(_first); }
+	const_subgames_iterator games_end() const { return const_subgames_iterator(last()); }
+	const_iterator& operator++() { _first = last(); return *this; }
+	const_iterator operator++(int) { const_iterator tmp = *this; ++*this; return tmp; }
+	bool operator==(const const_iterator &other) const { return _first == other._first; }
+	bool operator!=(const const_iterator &other) const { return _first != other._first; }
+    private:
+	friend class GameMap;
+	const_iterator(const Entry *first, const Entry *end) : _first(first), _end(end) { }
+	const Entry* last() const {
+	    const Entry *e = _first;
+	    while (e != _end && e->move == _first->move) ++e;
+	    return e;
+	}
+	const Entry *_first, *_end;
+    };
+
+    const_iterator begin() const {
+	assert(packed());
+	return const_iterator(_entries, _entries + _size);
     }
-    const_subgames_iterator games_end(const const_iterator &it) const {
-        assert(it->second != NULL);
-        return it->second->end();
+    const_iterator end() const {
+	assert(packed());
+	return const_iterator(_entries + _size, _entries + _size);
     }
-    size_t size() const { return _container.size(); }
+    const_iterator find(const TMove* move) const {
+	const_iterator it = lower_bound(begin(), move);
+	if (it != end() && it.move() == move) return it;
+	return end();
+    }
+    /**
+     * The first move starting at it that is not less than move.
+     */
+    const_iterator lower_bound(const const_iterator &it, const TMove* move) const {
+	const Entry *e = it._first, *eend = _entries + _size;
+	while (eend - e > 0) {
+	    size_t half = (eend - e) / 2;
+	    if (move_less(e[half].move, move)) e += half + 1;
+	    else eend = e + half;
+	}
+	return const_iterator(e, _entries + _size);
+    }
+    /**
+     * Number of pairs of moves and games.
+     */
+    size_t size() const { return packed() ? _size : _pending.size(); }
 
-    GameMap() : _hash(0UL) { }
+    GameMap() : _entries(NULL), _size(0), _hash(0UL) { }
     ~GameMap() {
-        const_iterator it = begin(), itend = end();
-	for (; it != itend; it++) delete it->second;
+	delete[] _entries;
+	typename std::vector<Pending>::const_iterator it = _pending.begin();
+	for (; it != _pending.end(); ++it) delete it->second;
     }
     bool operator==(const GameMap& other) const {
-	if (this->size() != other.size()) return false;
-	if (this->hash() != other.hash()) return false;
-	const_iterator it = _container.begin();
-	const_iterator itend = _container.end();
-	const_iterator otherend = other._container.end();
-	for (; it != itend; it++) {
-	    const_iterator oit = other._container.find(it->first);
-	    if (oit == otherend) return false;
-	    assert(it->second != NULL);
-	    assert(oit->second != NULL);
-	    if (*it->second != *oit->second) return false;
-	}
+	assert(packed() && other.packed());
+	if (_size != other._size) return false;
+	if (_hash != other._hash) return false;
+	for (size_t i = 0; i < _size; i++)
+	    if (_entries[i].move != other._entries[i].move
+		|| _entries[i].game != other._entries[i].game)
+		return false;
 	return true;
     }
-    bool insert(const Key& key, const MCGame_f* game) {
-	typename Container::const_iterator it = _container.find(key);
-	SubgamesContainer *set = NULL;
-    	if (it == _container.end()) {
-	    set = new SubgamesContainer();
-	    _container[key] = set;
-	} else {
-	    set = it->second;
+    void insert(const TMove* move, const MCGame_f* game) {
+	assert(!packed());
+	assert(game != NULL);
+	_pending.push_back(std::make_pair(move, game));
+    }
+    /**
+     * Sort the pairs inserted into the array.
+     */
+    void pack() {
+	assert(!packed());
+	std::sort(_pending.begin(), _pending.end(), PendingLess());
+	size_t n = 0;
+	for (size_t i = 0; i < _pending.size(); i++)
+	    if (i == 0 || !same(_pending[i - 1], _pending[i])) n++;
+	_entries = new Entry[n];
+	size_t h = hash_init();
+	for (size_t i = 0; i < _pending.size(); i++) {
+	    const Pending &p = _pending[i];
+	    if (_size == 0 || _entries[_size - 1].move != p.first
+		|| _entries[_size - 1].game.get() != p.second->get()) {
+		Entry &e = _entries[_size++];
+		e.move = p.first;
+		// adopt the reference of the inserted flyweight
+		e.game.swap(const_cast<MCGame_f&>(*p.second));
+		hash_combine(h, move_hash(e.move));
+		hash_combine(h, e.game.get()->hash());
+	    }
 	}
-	bool isnew = set->insert(game);
-	return isnew;
+	// delete the inserted flyweights (empty now) and the duplicates
+	for (size_t i = 0; i < _pending.size(); i++)
+	    delete _pending[i].second;
+	std::vector<Pending>().swap(_pending);
+	_hash = h;
     }
-	
-private:
+    bool packed() const { return _entries != NULL; }
     size_t hash() const {
-        if (_hash == 0UL)
-	    (const_cast<GameMap *>(this))->compute_hash();
-        return _hash; 
+	assert(packed());
+	return _hash;
     }
-    void compute_hash() {
-        size_t h = hash_init();
-	const_iterator it = _container.begin();
-	const_iterator itend = _container.end();
-	for (; it != itend; it++) {
-	    if (it->first != NULL)
-	        hash_combine(h, it->first->hash());
-	    else
-	        hash_combine(h, 13);
-	    hash_combine(h, it->second->hash());
-	}
-	_hash = h;
+
+private:
+    static size_t move_hash(const TMove* move) {
+	return move == NULL ? 1UL : move->hash();
+    }
+    static bool same(const Pending &p1, const Pending &p2) {
+	return p1.first == p2.first && p1.second->get() == p2.second->get();
     }
+    struct PendingLess {
+	bool operator()(const Pending &p1, const Pending &p2) const {
+	    if (p1.first != p2.first) return move_less(p1.first, p2.first);
+	    const MCGame *g1 = p1.second->get(), *g2 = p2.second->get();
+	    if (g1 == g2) return false;
+	    if (g1->hash() != g2->hash()) return g1->hash() < g2->hash();
+	    return g1 < g2;
+	}
+    };
 
-    Container _container;
-    /* forbid these */
-    GameMap(const GameMap& other) { };
-    GameMap& operator=(const GameMap& other) { return *this; };
+    Entry *_entries;
+    size_t _size;
     size_t _hash;
+    std::vector<Pending> _pending;
+    /* forbid these */
+    GameMap(const GameMap& other);
+    GameMap& operator=(const GameMap& other);
 
 public:
     /**
@@ -128,41 +228,17 @@ public:
      */
     class GameIterator {
     public:
-    	typedef typename std::pair<const Key, const MCGame_f*> value_type;
+    	typedef typename std::pair<const TMove*, const MCGame_f*> value_type;
 	GameIterator(const const_iterator &mit, const const_iterator &mitend)
-	: _mit(mit), _mitend(mitend), _has_next(false) {
-	    init_keys_it();
-	}
+	: _it(mit._first), _itend(mitend._first) { }
 	value_type next() {
-	    assert(_has_next);
-	    const MCGame_f* next_game = *_git;
-	    const Key &cur_move = _mit->first;
-	    advance_game_it();
-	    return std::make_pair(cur_move, next_game);
+	    assert(has_next());
+	    const Entry *e = _it++;
+	    return std::make_pair(e->move, &e->game);
 	}
-	bool has_next() const { return _has_next; }
+	bool has_next() const { return _it != _itend; }
     private:
-	const_iterator _mit, _mitend;
-	bool _has_next;
-	const_subgames_iterator _git, _gitend;
-	void advance_game_it() {
-	    _has_next = false;
-	    _git++;
-	    if (_git != _gitend) {
-		_has_next = true;
-		return;
-	    }
-	    _mit++;
-	    init_keys_it();
-	}
-	void init_keys_it() {
-	    if (_mit != _mitend) {
-	        _git = _mit->second->begin();
-		_gitend = _mit->second->end();
-		if (_git != _gitend)
-		    _has_next = true;
-	    }
-	}
+	const Entry *_it, *_itend;
     };
 };
 
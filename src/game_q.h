@@ -35,14 +35,14 @@ public:
     QUndetGame<TFormula, TMove, _player>(const TFormula* formula)
     : MCGame(formula) { }
     bool empty() const { return _subgames.size() == 0; }
-    typedef GameMap<const TMove*, ptr_deep_hasher<TMove> > GamesContainer;
+    typedef GameMap<TMove> GamesContainer;
     typedef typename GamesContainer::const_iterator const_iterator;
     typedef typename GamesContainer::const_subgames_iterator subgames_iterator;
     const_iterator begin() const { return _subgames.begin(); }
     const_iterator end() const { return _subgames.end(); }
     const_iterator find(const TMove* move) const { return _subgames.find(move); }
 
-    const MCGame_f* minimize() const;
+    const MCGame_f* minimize();
     const MCGame_f* add_subgame(const TMove *move, const MCGame_f* game);
     virtual const MCGame_f* introduce(const ConstantSymbol* tsym,
     			              int signature_depth,
@@ -68,13 +68,7 @@ protected:
     virtual void compute_hash() {
         size_t h = hash_init();
 	hash_combine(h, formula()->hash());
-	const_iterator it = begin();
-	const_iterator itend = end();
-	for (; it != itend; it++) {
-	    size_t move_h = (it->first == NULL ? 1 : it->first->hash());
-	    hash_combine(h, move_h);
-	    hash_combine(h, it->second->hash());
-	}
+	hash_combine(h, _subgames.hash());
 	hash(h);
     }
 private:
@@ -31,8 +31,9 @@
 namespace sequoia {
 
 template <typename TFormula, typename TMove, MCGame::Player _player>
-const MCGame_f* QUndetGame<TFormula, TMove, _player>::minimize() const {
+const MCGame_f* QUndetGame<TFormula, TMove, _player>::minimize() {
     assert(outcome() == MCGame::UNDETERMINED);
+    _subgames.pack();
     if (empty()) {
     	delete this;
     	return determined.get(MCGame::opponent<_player>::value);
@@ -44,11 +45,8 @@ const MCGame_f* QUndetGame<TFormula, TMove, _player>::minimize() const {
 template <typename TFormula, typename TMove, MCGame::Player _player> 
 void QUndetGame<TFormula, TMove, _player>::set_subgame(const TMove *move,
 						       const MCGame_f* game) {
-    bool res = _subgames.insert(move, game);
-    if (!res) { // new entry
-        // equivalent entry exists already, delete this game.
-        delete game;
-    }
+    // duplicates are dropped when the game is minimized
+    _subgames.insert(move, game);
 }
 
 template <typename TFormula, typename TMove, MCGame::Player _player>
@@ -190,28 +188,37 @@ const MCGame_f* QUndetGame<TFormula, TMove, _player>::join_impl(const MCGame_f*
     MyType* returngame = new MyType(formula());
     DEBUG(returngame->level(level()));
     
+    /*
+     * Both games are sorted by their moves, so we merge them and join
+     * the games of the moves present on both sides.
+     */
     const_iterator mit = begin();
     const_iterator mitend = end();
-    for (; mit != mitend; mit++) {
-	const SetMove* oldmove = mit->first;
+    const_iterator mit2 = gother->begin();
+    const_iterator mit2end = gother->end();
+    for (; mit != mitend && mit2 != mit2end; mit++) {
+	const SetMove* oldmove = mit.move();
+	while (mit2 != mit2end && GamesContainer::move_less(mit2.move(), oldmove))
+	    mit2++;
+	if (mit2 == mit2end || mit2.move() != oldmove) {
+	    DEBUG(tab_prefix(level()) << TOSTRING(oldmove) << " --> ignored in other, skip" << std::endl);
+            continue;
+	}
         DEBUG(tab_prefix(level()) << "Found Games for: " << TOSTRING(oldmove) << std::endl);
 
 	boost::scoped_ptr<const Assignment_f> my_alpha(AssignmentFlyFactory::make(
-                new SetAssignment(alpha, formula()->variable(), oldmove)));
+                SetAssignment::make(alpha, formula()->variable(), oldmove)));
 
-	const_iterator mit2 = gother->find(oldmove);
-	if (mit2 == gother->end()) {
-	    DEBUG(tab_prefix(level()) << TOSTRING(oldmove) << " --> ignored in other, skip" << std::endl);
-            continue;
-	}
-	GamePairIterator git(mit->second->begin(), mit->second->end(),
-	                     mit2->second->begin(), mit2->second->end());
+	GamePairIterator git(mit.games_begin(), mit.games_end(),
+	                     mit2.games_begin(), mit2.games_end());
 	while (git.has_next()) {
 	    GamePairIteratorValue res = git.next();
 	    const MCGame_f* g1 = res.first;
 	    const MCGame_f* g2 = res.second;
 #if USE_CACHE_SUBGAMES
-	    const MCGame_f *sub = cache_join_lookup(g1->get()->formula(), my_alpha.get(), g1, g2);
+	    CachePin<CacheJoinValue> cached = cache_join_lookup(g1->get()->formula(),
+								my_alpha.get(), g1, g2);
+	    const MCGame_f *sub = cached.empty() ? NULL : cached->clone();
 #else
 	    const MCGame_f *sub = NULL;
 #endif
@@ -255,7 +262,7 @@ const MCGame_f* QUndetGame<TFormula, TMove, _player>::join_impl(const MCGame_f*
 	const_iterator mit = sides[i]->begin();
 	const_iterator mitend = sides[i]->end();
 	for (; mit != mitend; mit++) {
-            const PointMove* oldmove = mit->first;
+            const PointMove* oldmove = mit.move();
             DEBUG(tab_prefix(level()) << "Found Games for: "
                     << TOSTRING(oldmove) << std::endl);
             // in the second run we do not need to re-check Terminal x Terminal
@@ -291,16 +298,18 @@ const MCGame_f* QUndetGame<TFormula, TMove, _player>::join_impl(const MCGame_f*
             }
             
 	    boost::scoped_ptr<const Assignment_f> my_alpha(AssignmentFlyFactory::make(
-                new ObjAssignment(alpha, formula()->variable(), oldmove)));
+                ObjAssignment::make(alpha, formula()->variable(), oldmove)));
 
-	    GamePairIterator git(mit->second->begin(), mit->second->end(),
-	                         mit2->second->begin(), mit2->second->end());
+	    GamePairIterator git(mit.games_begin(), mit.games_end(),
+	                         mit2.games_begin(), mit2.games_end());
 	    while (git.has_next()) {
 		GamePairIteratorValue res = git.next();
 		const MCGame_f* g1 = res.first;
 		const MCGame_f* g2 = res.second;
 #if USE_CACHE_SUBGAMES
-		const MCGame_f *sub = cache_join_lookup(g1->get()->formula(), my_alpha.get(), g1, g2);
+		CachePin<CacheJoinValue> cached = cache_join_lookup(g1->get()->formula(),
+								    my_alpha.get(), g1, g2);
+		const MCGame_f *sub = cached.empty() ? NULL : cached->clone();
 #else
 		const MCGame_f *sub = NULL;
 #endif
@@ -29,7 +29,7 @@ namespace sequoia {
 template <class Derived, class TMove>
 class QUndetGameForgetIteratorBase {
 public:
-    typedef GameMap<const TMove*, ptr_deep_hasher<TMove> > _MoveGameMap;
+    typedef GameMap<TMove> _MoveGameMap;
     typedef typename std::pair<const TMove*, const MCGame_f*> value_type;
     typedef const typename TMove::symbol_type* variable_type;
     typedef typename _MoveGameMap::const_iterator games_iterator;
@@ -91,7 +91,7 @@ class QUndetGameForgetIterator : public QUndetGameForgetIteratorBase<
     QUndetGameForgetIterator<TMove>, TMove> {
 public:
     typedef QUndetGameForgetIteratorBase<QUndetGameForgetIterator<TMove>, TMove> Base;
-    typedef GameMap<const TMove*, ptr_deep_hasher<TMove> > _MoveGameMap;
+    typedef GameMap<TMove> _MoveGameMap;
     typedef typename std::pair<const TMove*, const MCGame_f*> value_type;
     typedef typename TMove::symbol_type variable_type;
     typedef typename _MoveGameMap::const_iterator games_iterator;
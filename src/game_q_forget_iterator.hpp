@@ -62,12 +62,13 @@ QUndetGameForgetIteratorBase<Derived, TMove>::next() {
     }
 
     boost::scoped_ptr<const Assignment_f> my_alpha(AssignmentFlyFactory::make(
-        new SymAssignment<typename TMove::symbol_type, TMove>(alpha(), variable(),modified)));
+        SymAssignment<typename TMove::symbol_type, TMove>::make(alpha(), variable(),modified)));
     DEBUG(tab_prefix(level()) << "Modif: " << TOSTRING(modified) << std::endl);
 
 #if USE_CACHE_SUBGAMES
-    const MCGame_f* sub = cache_forget_lookup(oldgame->get()->formula(),
-                                              my_alpha.get(), oldgame, tsym());
+    CachePin<CacheForgetValue> cached = cache_forget_lookup(oldgame->get()->formula(),
+                                                            my_alpha.get(), oldgame, tsym());
+    const MCGame_f* sub = cached.empty() ? NULL : cached->clone();
 #else
     const MCGame_f *sub = NULL;
 #endif
@@ -50,7 +50,7 @@ QUndetGameIntroduceIterator<SetMove>::next() {
 	modified = moves_pool.pool(newmove);
     }
     boost::scoped_ptr<const Assignment_f> my_alpha(AssignmentFlyFactory::make(
-        new SetAssignment(alpha(), variable(), modified)));
+        SetAssignment::make(alpha(), variable(), modified)));
     DEBUG(tab_prefix(level()) << "Modif: " << TOSTRING(modified) << std::endl);
     const MCGame_f* sub = _cur_game->get()->introduce(tsym(),
 						      signature_depth(),
@@ -75,7 +75,7 @@ QUndetGameIntroduceIterator<PointMove>::next() {
 		<< " - point move on new terminal: " << std::endl);
 	assert(tmove != NULL);
 	boost::scoped_ptr<const Assignment_f> my_alpha(AssignmentFlyFactory::make(
-                new ObjAssignment(alpha(), variable(), tmove)));
+                ObjAssignment::make(alpha(), variable(), tmove)));
 	const MCGame_f* sub = _last_game->get()->introduce(tsym(),
 							 signature_depth(),
 							 my_alpha.get());
@@ -125,7 +125,7 @@ QUndetGameIntroduceIterator<PointMove>::next() {
     }
     DPRINTLN(" -mod-> " << TOSTRING(modified) << ":");
     boost::scoped_ptr<const Assignment_f> my_alpha(AssignmentFlyFactory::make(
-        new ObjAssignment(alpha(), variable(), modified)));
+        ObjAssignment::make(alpha(), variable(), modified)));
     const MCGame_f* sub = oldgame->get()->introduce(tsym(),
 						    signature_depth(),
 						    my_alpha.get());
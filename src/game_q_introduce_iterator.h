@@ -29,7 +29,7 @@ namespace sequoia {
 template <class Derived, class TMove>
 class QUndetGameIntroduceIteratorBase {
 public:
-    typedef GameMap<const TMove*, ptr_deep_hasher<TMove> > _MoveGameMap;
+    typedef GameMap<TMove> _MoveGameMap;
     typedef typename std::pair<const TMove*, const MCGame_f*> value_type;
     typedef const typename TMove::symbol_type* variable_type;
     typedef typename _MoveGameMap::const_iterator games_iterator;
@@ -76,7 +76,7 @@ class QUndetGameIntroduceIterator : public QUndetGameIntroduceIteratorBase<
     QUndetGameIntroduceIterator<TMove>, TMove> {
 public:
     typedef QUndetGameIntroduceIteratorBase<QUndetGameIntroduceIterator<TMove>, TMove> Base;
-    typedef GameMap<const TMove*, ptr_deep_hasher<TMove> > _MoveGameMap;
+    typedef GameMap<TMove> _MoveGameMap;
     typedef typename _MoveGameMap::const_iterator games_iterator;
     typedef typename std::pair<const TMove*, const MCGame_f*> value_type;
     QUndetGameIntroduceIterator<TMove>(
@@ -73,8 +73,8 @@ public:
         return !(*this == other);
     }
     typedef SEQUOIA_UNORDERED_SET<const MCGame_f*,
-        ptr_deep_hasher<MCGame_f, flyweight_inheritance_deep_hasher<MCGame> >,
-        ptr_deep_equals<const MCGame_f*> > Container;
+        flyweight_ptr_hasher<MCGame>,
+        flyweight_ptr_equals<MCGame> > Container;
     typedef Container::const_iterator const_iterator;
     const_iterator begin() const { return _container.begin(); }
     const_iterator end() const { return _container.end(); }
@@ -75,13 +75,13 @@ private:
                                  const Formula* subf,
                                  boost::scoped_ptr<const Assignment_f> &alpha) {
 	const SetMove* smove = moves_pool.pool(new SetMove(f->variable()));
-        alpha.reset(AssignmentFlyFactory::make(new SetAssignment(alpha.get(), f->variable(), smove)));
+        alpha.reset(AssignmentFlyFactory::make(SetAssignment::make(alpha.get(), f->variable(), smove)));
 	return smove;
     }
     const PointMove* prepare_index(const ObjQFormula* f,
                                    const Formula* subf,
                                    boost::scoped_ptr<const Assignment_f> &alpha) {
-        alpha.reset(AssignmentFlyFactory::make(new ObjAssignment(alpha.get(), f->variable(), NULL)));
+        alpha.reset(AssignmentFlyFactory::make(ObjAssignment::make(alpha.get(), f->variable(), NULL)));
 	return NULL;
     }
     const Formula* prepare_index(const ConjBoolCombFormula* f,
@@ -92,6 +92,13 @@ public:
      * O(1)
      */
     bool empty() const { return _sentinel->pred == _sentinel; }
+    /**
+     * O(1)
+     */
+    const Value* front() const {
+        assert(!empty());
+        return _sentinel->succ->value();
+    }
     /**
      * O(1)
      */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_LOCKED_VECTOR_H
+#define	SEQUOIA_LOCKED_VECTOR_H
+
+#include <mutex>
+#include <vector>
+
+namespace sequoia {
+
+/**
+ * Replacement for tbb::concurrent_vector if TBB is not available.
+ * Only push_back() is safe to be called concurrently; iteration
+ * must not overlap with any modification.
+ */
+template <typename T>
+class LockedVector {
+    typedef std::vector<T> Impl;
+public:
+    typedef typename Impl::const_iterator const_iterator;
+    typedef typename Impl::size_type size_type;
+
+    void push_back(const T& value) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _impl.push_back(value);
+    }
+    const_iterator begin() const { return _impl.begin(); }
+    const_iterator end() const { return _impl.end(); }
+    size_type size() const { return _impl.size(); }
+private:
+    Impl _impl;
+    std::mutex _mutex;
+};
+
+} // namespace
+
+#endif	/* SEQUOIA_LOCKED_VECTOR_H */
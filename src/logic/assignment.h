@@ -22,6 +22,7 @@
 #ifndef SEQUOIA_LOGIC_ASSIGNMENT_H
 #define	SEQUOIA_LOGIC_ASSIGNMENT_H
 
+#include <new>
 #include "flyweight.h"
 #include "flyweight_inheritance.h"
 #include "moves.h"
@@ -35,25 +36,85 @@ typedef FlyweightInheritanceFactory<Assignment> AssignmentFlyFactory;
 
 /**
  * Assignments of symbols
+ *
+ * Symbols are assigned by increasing nesting depth.  Each assignment
+ * holds the moves of all its symbols in a flat array indexed by the
+ * nesting depth, so lookups take constant time and extending an
+ * assignment copies its parent's array and sets one slot.  The array
+ * is allocated together with the assignment, see SymAssignment::make().
  */
-class Assignment {
+class Assignment : public FlyweightObject {
 public:
-    Assignment() : _hash(0UL) { }
+    Assignment() : _slots(NULL), _size(0), _hash(0UL) { }
     virtual ~Assignment() { }
+    /* Assignments with slots are allocated by ::operator new() in
+     * SymAssignment::make(), so this must not be a sized delete. */
+    static void operator delete(void *p) { ::operator delete(p); }
     size_t hash() const { assert(_hash != 0UL); return _hash; }
-    virtual const PointMove* get(const ConstantSymbol* sym) const = 0;
-    virtual const SetMove* get(const UnarySymbol* sym) const = 0;
-    virtual bool assigned(const ConstantSymbol *sym) const = 0;
-    virtual bool assigned(const UnarySymbol *sym) const = 0;
+    const PointMove* get(const ConstantSymbol* sym) const {
+        assert(assigned(sym));
+        return static_cast<const PointMove*>(_slots[sym->nesting_depth()].move);
+    }
+    const SetMove* get(const UnarySymbol* sym) const {
+        assert(assigned(sym));
+        return static_cast<const SetMove*>(_slots[sym->nesting_depth()].move);
+    }
+    bool assigned(const Symbol *sym) const {
+        unsigned int d = sym->nesting_depth();
+        return d < _size && _slots[d].symbol == sym;
+    }
     /**
      * This one is needed for now, because forget/introduce need a _fast_ way
      * to retrieve an interpretation based on the previous' move nesting depth.
      */
-    virtual const PointMove* get_pointmove(unsigned int depth) const = 0;
-    virtual unsigned int depth() const = 0;
+    const PointMove* get_pointmove(unsigned int depth) const {
+        assert(_size == 0 || depth < _size);
+        if (depth >= _size || _slots[depth].symbol == NULL
+            || _slots[depth].symbol->arity() != 0)
+            return NULL;
+        return static_cast<const PointMove*>(_slots[depth].move);
+    }
+    /**
+     * The symbol assigned at the given nesting depth, NULL if none.
+     */
+    const Symbol* symbol_at(unsigned int depth) const {
+        return depth < _size ? _slots[depth].symbol : NULL;
+    }
+    /**
+     * The nesting depth of the deepest symbol assigned, 0 if none.
+     */
+    unsigned int depth() const { return _size == 0 ? 0 : _size - 1; }
 protected:
+    struct Slot {
+        const Symbol *symbol;
+        const void *move;
+    };
     void hash(size_t hash) { this->_hash = hash; }
+    /**
+     * Copy the parent's slots to slots, which has room for
+     * sym->nesting_depth() + 1 entries, and assign sym.
+     */
+    void extend(const Assignment *parent, const Symbol *sym, const void *move,
+                Slot *slots) {
+        unsigned int d = sym->nesting_depth();
+        assert(parent->_size <= d);
+        _size = d + 1;
+        _slots = slots;
+        for (unsigned int i = 0; i < parent->_size; i++)
+            _slots[i] = parent->_slots[i];
+        for (unsigned int i = parent->_size; i < d; i++) {
+            _slots[i].symbol = NULL;
+            _slots[i].move = NULL;
+        }
+        _slots[d].symbol = sym;
+        _slots[d].move = move;
+    }
 private:
+    Assignment(const Assignment&);
+    Assignment& operator=(const Assignment&);
+
+    Slot *_slots;
+    unsigned int _size;
     size_t _hash;
 };
 
@@ -61,74 +122,56 @@ private:
 class EmptyAssignment : public Assignment {
 public:
     EmptyAssignment() { hash(1UL); }
-    const PointMove* get(const ConstantSymbol* sym) const { assert(false); return NULL; }
-    const SetMove* get(const UnarySymbol* sym) const { assert(false); return NULL; }
-    const PointMove* get_pointmove(unsigned int depth) const { return NULL; }
     bool operator==(const EmptyAssignment &other) const { return true; }
     bool operator!=(const EmptyAssignment &other) const { return false; }
-    virtual bool assigned(const ConstantSymbol *sym) const { return false; }
-    virtual bool assigned(const UnarySymbol *sym) const { return false; }
-    virtual unsigned int depth() const { return 0; }
 };
 
 template <typename TSymbol, typename TMove>
 class SymAssignment : public Assignment {
 public:
-    SymAssignment<TSymbol, TMove>(const Assignment_f *parent,
-                                  const TSymbol *symbol,
-				  const TMove* move)
-    : _parent(parent->clone()), _symbol(symbol), _move(move) {
-        assert(!_parent->get()->assigned(_symbol)); // for debugging
-        size_t h = hash_init();
-        hash_combine(h, _parent->get()->hash());
-        hash_combine(h, _symbol->hash());
-        if (_move != NULL)
-            hash_combine(h, _move->hash());
-        hash(h);
-    }
-    ~SymAssignment<TSymbol, TMove>() {
-	delete _parent;
-    }
-    const PointMove* get(const ConstantSymbol* sym) const {
-        if (boost::is_base_of<TSymbol, ConstantSymbol>::value) // optimized out by compiler
-            if (sym == (const ConstantSymbol*) _symbol) return (const PointMove*) _move;
-        return _parent->get()->get(sym);
-    }
-    const SetMove* get(const UnarySymbol *sym) const {
-        if (boost::is_base_of<TSymbol, UnarySymbol>::value) // optimized out by compiler
-            if (sym == (const UnarySymbol*) _symbol) return (const SetMove*) _move;
-        return _parent->get()->get(sym);
-    }
-
-    const PointMove* get_pointmove(unsigned int depth) const {
-	assert(depth <= _symbol->nesting_depth());
-        if (boost::is_base_of<TSymbol, ConstantSymbol>::value) // optimized out by compiler
-            if (depth == _symbol->nesting_depth()) return (const PointMove*) _move;
-	return _parent->get()->get_pointmove(depth);
+    /**
+     * Extend parent by symbol := move.  The slots are stored right
+     * behind the object, in the same allocation.
+     */
+    static SymAssignment<TSymbol, TMove>* make(const Assignment_f *parent,
+                                               const TSymbol *symbol,
+                                               const TMove* move) {
+        size_t size = sizeof(SymAssignment<TSymbol, TMove>)
+            + (symbol->nesting_depth() + 1) * sizeof(Slot);
+        void *p = ::operator new(size);
+        return ::new (p) SymAssignment<TSymbol, TMove>(parent, symbol, move);
     }
 
+    /* The parent is interned, so equal parents are the same object. */
     bool operator==(const SymAssignment<TSymbol, TMove>& other) const {
         if (hash() != other.hash()) return false;
         if (_symbol != other._symbol) return false;
         if (_move != other._move) return false;
-        return *_parent == *other._parent;
+        return _parent == other._parent;
     }
     bool operator!=(const SymAssignment<TSymbol, TMove>& other) const {
         return !(*this == other);
     }
-    virtual bool assigned(const ConstantSymbol* sym) const {
-        if (boost::is_base_of<TSymbol, ConstantSymbol>::value) // optimized out by compiler
-            if (sym == (const ConstantSymbol*) _symbol) return true;
-        return _parent->get()->assigned(sym);
-    }
-    virtual bool assigned(const UnarySymbol *sym) const {
-        if (boost::is_base_of<TSymbol, UnarySymbol>::value) // optimized out by compiler
-            if (sym == (const UnarySymbol*) _symbol) return true;
-        return _parent->get()->assigned(sym);
-    }
-    virtual unsigned int depth() const { return _symbol->nesting_depth(); }
+    const Assignment_f* parent() const { return &_parent; }
+    const TSymbol* symbol() const { return _symbol; }
+    const TMove* move() const { return _move; }
 private:
-    const Assignment_f *_parent;
+    SymAssignment<TSymbol, TMove>(const Assignment_f *parent,
+                                  const TSymbol *symbol,
+				  const TMove* move)
+    : _parent(*parent), _symbol(symbol), _move(move) {
+        const Assignment *p = _parent.get();
+        assert(!p->assigned(_symbol)); // for debugging
+        extend(p, _symbol, _move, reinterpret_cast<Slot*>(this + 1));
+        size_t h = hash_init();
+        hash_combine(h, p->hash());
+        hash_combine(h, _symbol->hash());
+        if (_move != NULL)
+            hash_combine(h, _move->hash());
+        hash(h);
+    }
+
+    Assignment_f _parent;
     const TSymbol *_symbol;
     const TMove *_move;
 };
@@ -78,7 +78,7 @@ public:
      * @param s The object to add.
      */
     void add(unsigned int n) {
-	assert(n < 64);
+	assert(n < move_bits());
         assert(n < nesting_depth());
         assert(!test(n));
         _members.set(n);
@@ -96,7 +96,7 @@ public:
      * @param s The object to remove.
      */
     void remove(unsigned int n) {
-	assert(n < 64);
+	assert(n < move_bits());
         assert(n < nesting_depth());
         assert(test(n));
         _members.set(n, 0);
@@ -112,7 +112,7 @@ public:
      * @param s The symbol to test.
      */
     bool test(unsigned int n) const {
-	assert(n < 64);
+	assert(n < move_bits());
         return _members.test(n);
     }
     bool test(const ConstantSymbol* s) const {
@@ -185,10 +185,11 @@ private:
      */
     void rename_obj_up(unsigned int from_depth, unsigned int to_depth) {
 	assert(to_depth > 0);
-        assert(to_depth - 1 < nesting_depth());
+        assert(to_depth + 1 < nesting_depth());
         assert(to_depth >= from_depth);
-        for (unsigned int i = to_depth+1; i > from_depth; --i)
-            rename_obj(i-1, i);
+        assert(!test(to_depth + 1));
+        BitSet range = bitset_range(from_depth, to_depth);
+        _members = (_members & ~range) | ((_members & range) << 1);
         hash(0UL);
     }
     /**
@@ -202,34 +203,20 @@ private:
     void rename_obj_down(unsigned int from_depth, unsigned int to_depth) {
         assert(to_depth >= from_depth);
         assert(from_depth > 0);
-        for (unsigned int i = from_depth; i <= to_depth; ++i)
-            rename_obj(i, i-1);
+        assert(to_depth < nesting_depth());
+        assert(!test(from_depth - 1));
+        BitSet range = bitset_range(from_depth, to_depth);
+        _members = (_members & ~range) | ((_members & range) >> 1);
         hash(0UL);
     }
+
     /**
-     * Apply renaming operation of constants.
-     * @param from
-     * @param to
+     * The members are never set beyond the nesting depth, and the
+     * symbol determines the nesting depth, so we hash the raw bits.
      */
-    void rename_obj(unsigned int from, unsigned int to) {
-        assert(from < nesting_depth());
-        assert(to < nesting_depth());
-        assert(from != to);
-        assert(!test(to));
-        if (test(from)) {
-            add(to);
-            remove(from);
-        }
-        hash(0UL);
-    }
-
     void compute_hash() {
-        size_t h = hash_init();
-	hash_combine(h, _symbol->hash());
-	hash_combine(h, nesting_depth());
-	hash_combine(h, _size);
-        for (size_t i = 0; i < nesting_depth(); ++i)
-	    hash_combine(h, _members.test(i));
+        size_t h = _symbol->hash();
+	hash_combine(h, bitset_hash(_members));
         hash(h);
     }
     const UnarySymbol* _symbol;
@@ -271,7 +258,7 @@ public:
      * @param n the depth
      */
     void add_label(unsigned int n) {
-	assert(n < 64);
+	assert(n < move_bits());
         assert(n < nesting_depth());
         assert(!_labels.test(n));
         _labels.set(n);
@@ -287,7 +274,7 @@ public:
      * @param s The UnarySymbol of the set.
      */
     void remove_label(unsigned int n) {
-	assert(n < 64);
+	assert(n < move_bits());
         assert(n < nesting_depth());
         assert(_labels.test(n));
         _labels.reset(n);
@@ -299,7 +286,7 @@ public:
      * @return true iff the object is contained in the set.
      */
     bool test_label(unsigned int n) const {
-	assert(n < 64);
+	assert(n < move_bits());
 	return _labels.test(n);
     }
     bool test_label(const UnarySymbol *s) const {
@@ -311,7 +298,7 @@ public:
      * @param s The ConstantSymbol of the object.
      */
     void add_edge(unsigned int n) {
-	assert(n < 64);
+	assert(n < move_bits());
         assert(n < nesting_depth());
         assert(!_edges.test(n));
         _edges.set(n);
@@ -326,7 +313,7 @@ public:
      * @param n The ConstantSymbol of the object.
      */
     void remove_edge(unsigned int n) {
-	assert(n < 64);
+	assert(n < move_bits());
         assert(n < nesting_depth());
         assert(_edges.test(n));
         _edges.reset(n);
@@ -489,8 +476,13 @@ private:
     void rename_obj_up(int from_depth, int to_depth) {
 	if (to_depth == 0) return; // nothing to rename
 	assert(to_depth - 1 < (int) nesting_depth());
-        for (int i = to_depth+1; i > from_depth; --i)
-            rename_obj(i-1, i);
+	if (from_depth > to_depth) return;
+	assert(to_depth + 1 != (int) nesting_depth());
+	assert(!_edges.test(to_depth + 1));
+	BitSet range = bitset_range(from_depth, to_depth);
+	BitSet moved = (_edges & range) << 1;
+	assert(moved.none() || to_depth + 1 < (int) nesting_depth());
+	_edges = (_edges & ~range) | moved;
         hash(0UL);
     }
 
@@ -505,40 +497,21 @@ private:
     void rename_obj_down(unsigned int from_depth, unsigned int to_depth) {
         assert(from_depth > 0);
 	assert(to_depth < nesting_depth());
-        for (unsigned int i = from_depth; i <= to_depth; ++i)
-            rename_obj(i, i - 1);
+	if (from_depth > to_depth) return;
+	assert(!_edges.test(from_depth - 1));
+	BitSet range = bitset_range(from_depth, to_depth);
+	_edges = (_edges & ~range) | ((_edges & range) >> 1);
         hash(0UL);
     }
 
-
     /**
-     * Rename constant symbols and adjust the nesting depths accordingly.
-     * This possibly includes the current object.
-     * @param from
-     * @param to
+     * Labels and edges are never set beyond the nesting depth, see
+     * SetMove::compute_hash().
      */
-    void rename_obj(unsigned int from, unsigned int to) {
-	assert(from != nesting_depth());
-	assert(to != nesting_depth());
-        assert(from != to);
-        assert(_edges.test(to) == false);
-        if (_edges.test(from)) {
-            remove_edge(from);
-            if (to <= nesting_depth()) {
-                add_edge(to);
-            }
-        }
-        hash(0UL);
-    }
-
     void compute_hash() {
-        size_t h = hash_init();
-	hash_combine(h, _symbol->hash());
-	hash_combine(h, nesting_depth());
-        for (size_t i = 0; i < nesting_depth(); ++i)
-	    hash_combine(h, _edges.test(i));
-        for (size_t i = 0; i < nesting_depth(); ++i)
-	    hash_combine(h, _labels.test(i));
+        size_t h = _symbol->hash();
+	hash_combine(h, bitset_hash(_edges));
+	hash_combine(h, bitset_hash(_labels));
         hash(h);
     }
     const ConstantSymbol* _symbol;
@@ -0,0 +1,265 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_MOVE_BITSET_H
+#define	SEQUOIA_MOVE_BITSET_H
+
+#include "hashing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <stdint.h>
+
+namespace sequoia {
+
+/**
+ * Maximal number of words of the bitsets in the moves.  The moves have
+ * one bit per symbol of the annotated vocabulary, the number of words
+ * actually used is chosen per formula, see set_move_words().
+ */
+#ifndef SEQUOIA_MAX_MOVE_WORDS
+#define SEQUOIA_MAX_MOVE_WORDS 4
+#endif
+
+// debug builds use short words, such that small formulas need
+// several of them
+#ifdef DODEBUG
+typedef uint16_t MoveWord;
+#else
+typedef unsigned long MoveWord;
+#endif
+#define MOVE_WORD_BITS (sizeof(MoveWord) * 8)
+#define BITSET_SIZE (SEQUOIA_MAX_MOVE_WORDS * MOVE_WORD_BITS)
+
+namespace internal {
+extern unsigned int move_words;
+} // namespace internal
+
+/**
+ * Number of words of the bitsets in use.
+ */
+inline unsigned int move_words() { return internal::move_words; }
+/**
+ * Number of bits of the bitsets in use, the moves can handle symbols of
+ * nesting depth less than this.
+ */
+inline unsigned int move_bits() { return move_words() * MOVE_WORD_BITS; }
+/**
+ * Use the given number of words.  The bitsets are stored differently
+ * for one and for several words, so this must be called before any
+ * bitset (or move) is created, and must not be changed afterwards.
+ */
+void set_move_words(unsigned int words);
+
+/**
+ * The bitsets of the moves.  With a single word in use (up to 63
+ * symbols), a bitset is just that word, and all operations are plain
+ * word operations.  Wider bitsets keep their move_words() words in an
+ * array on the heap.
+ */
+class BitSet {
+public:
+    BitSet() {
+	if (wide())
+	    _words = new MoveWord[move_words()]();
+	else
+	    _word = 0;
+    }
+    BitSet(const BitSet& other) {
+	if (wide()) {
+	    _words = new MoveWord[move_words()];
+	    std::copy(other._words, other._words + move_words(), _words);
+	} else {
+	    _word = other._word;
+	}
+    }
+    ~BitSet() {
+	if (wide())
+	    delete[] _words;
+    }
+    BitSet& operator=(const BitSet& other) {
+	if (wide())
+	    std::copy(other._words, other._words + move_words(), _words);
+	else
+	    _word = other._word;
+	return *this;
+    }
+    BitSet& operator=(BitSet&& other) {
+	if (wide())
+	    std::swap(_words, other._words);
+	else
+	    _word = other._word;
+	return *this;
+    }
+    /**
+     * The bits from ... to (inclusive) set, all others cleared.
+     */
+    static BitSet range(unsigned int from, unsigned int to) {
+	assert(from <= to && to < move_bits());
+	if (!wide())
+	    return BitSet(mask(from, to));
+	BitSet res;
+	unsigned int first = from / MOVE_WORD_BITS, last = to / MOVE_WORD_BITS;
+	for (unsigned int i = first; i <= last; i++)
+	    res._words[i] = mask(i == first ? from % MOVE_WORD_BITS : 0,
+				 i == last ? to % MOVE_WORD_BITS : MOVE_WORD_BITS - 1);
+	return res;
+    }
+
+    bool test(unsigned int n) const {
+	assert(n < move_bits());
+	return (data()[n / MOVE_WORD_BITS] >> (n % MOVE_WORD_BITS)) & 1;
+    }
+    BitSet& set(unsigned int n, bool value = true) {
+	assert(n < move_bits());
+	MoveWord bit = (MoveWord)1 << (n % MOVE_WORD_BITS);
+	MoveWord &word = data()[n / MOVE_WORD_BITS];
+	if (value)
+	    word |= bit;
+	else
+	    word &= (MoveWord)~bit;
+	return *this;
+    }
+    BitSet& reset(unsigned int n) { return set(n, false); }
+    bool none() const {
+	if (!wide())
+	    return _word == 0;
+	for (unsigned int i = 0; i < move_words(); i++)
+	    if (_words[i] != 0) return false;
+	return true;
+    }
+
+    BitSet operator&(const BitSet& other) const {
+	if (!wide())
+	    return BitSet(_word & other._word);
+	BitSet res(*this);
+	for (unsigned int i = 0; i < move_words(); i++)
+	    res._words[i] &= other._words[i];
+	return res;
+    }
+    BitSet operator|(const BitSet& other) const {
+	if (!wide())
+	    return BitSet(_word | other._word);
+	BitSet res(*this);
+	for (unsigned int i = 0; i < move_words(); i++)
+	    res._words[i] |= other._words[i];
+	return res;
+    }
+    BitSet operator~() const {
+	if (!wide())
+	    return BitSet((MoveWord)~_word);
+	BitSet res(*this);
+	for (unsigned int i = 0; i < move_words(); i++)
+	    res._words[i] = (MoveWord)~res._words[i];
+	return res;
+    }
+    /**
+     * Shift by one bit towards the higher resp. lower positions.  Bits
+     * shifted beyond move_bits() are lost.
+     */
+    BitSet operator<<(unsigned int n) const {
+	assert(n == 1);
+	if (!wide())
+	    return BitSet((MoveWord)(_word << 1));
+	BitSet res;
+	MoveWord carry = 0;
+	for (unsigned int i = 0; i < move_words(); i++) {
+	    res._words[i] = (MoveWord)(_words[i] << 1) | carry;
+	    carry = _words[i] >> (MOVE_WORD_BITS - 1);
+	}
+	return res;
+    }
+    BitSet operator>>(unsigned int n) const {
+	assert(n == 1);
+	if (!wide())
+	    return BitSet((MoveWord)(_word >> 1));
+	BitSet res;
+	MoveWord carry = 0;
+	for (unsigned int i = move_words(); i-- > 0; ) {
+	    res._words[i] = (MoveWord)(_words[i] >> 1) | carry;
+	    carry = (MoveWord)(_words[i] << (MOVE_WORD_BITS - 1));
+	}
+	return res;
+    }
+    bool operator==(const BitSet& other) const {
+	if (!wide())
+	    return _word == other._word;
+	for (unsigned int i = 0; i < move_words(); i++)
+	    if (_words[i] != other._words[i]) return false;
+	return true;
+    }
+    bool operator!=(const BitSet& other) const { return !(*this == other); }
+
+    /**
+     * Hash value of the raw words.  Cleared words beyond the first do
+     * not contribute, so narrow sets hash the same in either width.
+     */
+    size_t hash() const {
+	if (!wide())
+	    return _word;
+	size_t h = _words[0];
+	for (unsigned int i = 1; i < move_words(); i++)
+	    if (_words[i] != 0) {
+		hash_combine(h, i);
+		hash_combine(h, _words[i]);
+	    }
+	return h;
+    }
+
+private:
+    explicit BitSet(MoveWord word) : _word(word) { assert(!wide()); }
+    static bool wide() { return move_words() > 1; }
+    /**
+     * The bits lo ... hi (inclusive) of a word.
+     */
+    static MoveWord mask(unsigned int lo, unsigned int hi) {
+	return (MoveWord)((MoveWord)~(MoveWord)0 >> (MOVE_WORD_BITS - 1 - (hi - lo))) << lo;
+    }
+    MoveWord* data() { return wide() ? _words : &_word; }
+    const MoveWord* data() const { return wide() ? _words : &_word; }
+
+    union {
+	MoveWord _word;
+	MoveWord *_words;
+    };
+};
+
+/**
+ * Print the bits in use, highest first (like std::bitset).
+ */
+inline std::ostream& operator<<(std::ostream& os, const BitSet& bits) {
+    for (unsigned int i = move_bits(); i-- > 0; )
+	os << (bits.test(i) ? '1' : '0');
+    return os;
+}
+
+inline BitSet bitset_range(unsigned int from, unsigned int to) {
+    return BitSet::range(from, to);
+}
+
+inline size_t bitset_hash(const BitSet& bits) {
+    return bits.hash();
+}
+
+} // namespace
+
+#endif	// SEQUOIA_MOVE_BITSET_H
@@ -0,0 +1,150 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "common.h"
+#include "exceptions.h"
+#include "numa_topology.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace sequoia {
+
+SchedulingPolicy scheduling_policy_from_string(const std::string& name) {
+    if (name == "all")
+        return SCHEDULE_ALL_CORES;
+    if (name == "socket")
+        return SCHEDULE_SOCKET_PINNED;
+    throw sequoia_usage_error("Unknown scheduling policy: " + name);
+}
+
+namespace {
+
+/**
+ * Parse a sysfs cpu list such as "0-7,16-23".
+ */
+std::vector<int> parse_cpulist(const std::string& line) {
+    std::vector<int> cpus;
+    std::stringstream s(line);
+    std::string range;
+    while (std::getline(s, range, ',')) {
+        if (range.empty() || range[0] == '\n')
+            continue;
+        size_t dash = range.find('-');
+        int from = atoi(range.c_str());
+        int to = dash == std::string::npos ? from : atoi(range.c_str() + dash + 1);
+        for (int cpu = from; cpu <= to; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+} // namespace
+
+NumaTopology::NumaTopology() {
+#ifdef __linux__
+    const char* sysfs = "/sys/devices/system/node";
+    DIR* dir = opendir(sysfs);
+    if (dir != NULL) {
+        std::vector<int> ids;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            std::string name(entry->d_name);
+            if (name.compare(0, 4, "node") == 0 && name.size() > 4 &&
+                name.find_first_not_of("0123456789", 4) == std::string::npos)
+                ids.push_back(atoi(name.c_str() + 4));
+        }
+        closedir(dir);
+        std::sort(ids.begin(), ids.end());
+        for (unsigned int i = 0; i < ids.size(); i++) {
+            std::stringstream path;
+            path << sysfs << "/node" << ids[i] << "/cpulist";
+            std::ifstream in(path.str().c_str());
+            std::string line;
+            std::getline(in, line);
+            std::vector<int> cpus = parse_cpulist(line);
+            if (!cpus.empty()) // skip memory-only nodes
+                _nodes.push_back(cpus);
+        }
+    }
+    if (_nodes.empty()) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        std::vector<int> cpus;
+        for (long i = 0; i < std::max(n, 1L); i++)
+            cpus.push_back(i);
+        _nodes.push_back(cpus);
+    }
+#else
+    _nodes.push_back(std::vector<int>());
+#endif
+}
+
+bool NumaTopology::pin_current_thread(size_t node) const {
+#ifdef __linux__
+    assert(node < _nodes.size());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned int i = 0; i < _nodes[node].size(); i++)
+        CPU_SET(_nodes[node][i], &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+ScopedThreadPin::ScopedThreadPin(const NumaTopology* topology, size_t node)
+: _pinned(false) {
+#ifdef __linux__
+    if (topology == NULL)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return; // we could not restore it
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &set))
+            _saved_cpus.push_back(cpu);
+    _pinned = topology->pin_current_thread(node);
+#endif
+}
+
+ScopedThreadPin::~ScopedThreadPin() {
+#ifdef __linux__
+    if (!_pinned)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned int i = 0; i < _saved_cpus.size(); i++)
+        CPU_SET(_saved_cpus[i], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+} // namespace
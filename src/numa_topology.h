@@ -0,0 +1,86 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_NUMA_TOPOLOGY_H
+#define	SEQUOIA_NUMA_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+namespace sequoia {
+
+/**
+ * How the dynamic programming assigns worker threads to processors.
+ */
+enum SchedulingPolicy {
+    // use all processors, leave thread placement to the OS
+    SCHEDULE_ALL_CORES,
+    // pin workers to NUMA nodes (sockets) and keep subtrees on a node
+    SCHEDULE_SOCKET_PINNED
+};
+
+/**
+ * Parse a policy name ("all" or "socket").
+ * Throws sequoia_usage_error on unknown names.
+ */
+SchedulingPolicy scheduling_policy_from_string(const std::string& name);
+
+/**
+ * The NUMA nodes of the machine and their processors.  On Linux, the
+ * topology is read from sysfs; elsewhere (or if sysfs is unavailable),
+ * the machine is treated as a single node.
+ */
+class NumaTopology {
+public:
+    NumaTopology();
+
+    size_t num_nodes() const { return _nodes.size(); }
+    const std::vector<int>& cpus(size_t node) const { return _nodes[node]; }
+
+    /**
+     * Pin the calling thread to the processors of the given node.
+     * @return false if thread pinning is not supported
+     */
+    bool pin_current_thread(size_t node) const;
+private:
+    std::vector<std::vector<int> > _nodes;
+};
+
+/**
+ * Pins the calling thread to a node while the object lives and restores
+ * the thread's previous affinity afterwards.  Does nothing without a
+ * topology.
+ */
+class ScopedThreadPin {
+public:
+    ScopedThreadPin(const NumaTopology* topology, size_t node);
+    ~ScopedThreadPin();
+private:
+    ScopedThreadPin(const ScopedThreadPin&);
+    ScopedThreadPin& operator=(const ScopedThreadPin&);
+
+    bool _pinned;
+    std::vector<int> _saved_cpus; // the previous affinity
+};
+
+} // namespace
+
+#endif	/* SEQUOIA_NUMA_TOPOLOGY_H */
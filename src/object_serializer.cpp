@@ -0,0 +1,503 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "object_serializer.h"
+#include "game_atomar.h"
+#include "game_bool_comb.h"
+#include "game_determined.h"
+#include "game_q.h"
+#include "moves_pool.h"
+#include "temp_symbol_factory.h"
+#include "logic/formula_visitor.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <cstring>
+#include <sstream>
+
+namespace sequoia {
+
+namespace {
+
+enum { OBJECT_NULL, OBJECT_NEW, OBJECT_REF };
+enum { ALPHA_SET, ALPHA_OBJ };
+enum {
+    GAME_FALSE = MCGame::FALSIFIER, GAME_TRUE = MCGame::VERIFIER, GAME_ATOMAR,
+    GAME_UNIV_SET, GAME_EXIST_SET, GAME_UNIV_OBJ, GAME_EXIST_OBJ,
+    GAME_CONJ, GAME_DISJ
+};
+
+// symbol codes of the temporary symbols, the depth is in the lower bits
+const uint32_t TEMPORARY_SYMBOL = 0x80000000U;
+
+/**
+ * Number of words of 64 bits the bitsets of the moves are written in.
+ */
+unsigned int
+serialized_move_words() {
+    return (move_bits() + 63) / 64;
+}
+
+} // namespace
+
+/**
+ * Collects the subformulas in preorder.
+ */
+class FormulaIndexBuilder : private FormulaVisitor {
+public:
+    explicit FormulaIndexBuilder(std::vector<const Formula*> &formulas)
+    : _formulas(formulas) { }
+    void build(const Formula *root) { root->accept(this); }
+private:
+    void visit(const UnivSetQFormula* f) { visit_q(f); }
+    void visit(const ExistSetQFormula* f) { visit_q(f); }
+    void visit(const UnivObjQFormula* f) { visit_q(f); }
+    void visit(const ExistObjQFormula* f) { visit_q(f); }
+    void visit(const ConjBoolCombFormula* f) { visit_bool_comb(f); }
+    void visit(const DisjBoolCombFormula* f) { visit_bool_comb(f); }
+    void visit(const AtomarFormulaMember* f) { _formulas.push_back(f); }
+    void visit(const AtomarFormulaAdj* f) { _formulas.push_back(f); }
+    void visit(const AtomarFormulaEquals* f) { _formulas.push_back(f); }
+    void visit(const NegatedFormula* f) {
+	_formulas.push_back(f);
+	f->subformula()->accept(this);
+    }
+    void visit_q(const QFormula* f) {
+	_formulas.push_back(f);
+	(*f->subformulas_begin())->accept(this);
+    }
+    void visit_bool_comb(const BoolCombFormula* f) {
+	_formulas.push_back(f);
+	BoolCombFormula::subformula_iterator it;
+	for (it = f->subformulas_begin(); it != f->subformulas_end(); ++it)
+	    (*it)->accept(this);
+    }
+
+    std::vector<const Formula*> &_formulas;
+};
+
+FormulaIndex::FormulaIndex(const Formula *root) {
+    FormulaIndexBuilder builder(_formulas);
+    builder.build(root);
+    for (unsigned int i = 0; i < _formulas.size(); i++) {
+	_formula_ids[_formulas[i]] = i;
+	const Vocabulary *voc = _formulas[i]->vocabulary();
+	for (unsigned int j = 0; j < voc->size(); j++) {
+	    const Symbol *s = voc->symbol(j);
+	    if (_symbol_ids.find(s) != _symbol_ids.end())
+		continue;
+	    _symbol_ids[s] = _symbols.size();
+	    _symbols.push_back(s);
+	}
+    }
+    for (unsigned int d = 0; d < BITSET_SIZE; d++)
+	_symbol_ids[create_temporary_symbol(d)] = TEMPORARY_SYMBOL | d;
+
+    std::stringstream s;
+    s << move_bits() << "\n" << root->toString() << "\n";
+    for (unsigned int i = 0; i < _symbols.size(); i++)
+	s << _symbols[i]->identifier() << "/" << _symbols[i]->arity()
+	  << "/" << _symbols[i]->nesting_depth()
+	  << "/" << _symbols[i]->variable() << "\n";
+    _fingerprint = s.str();
+}
+
+const Symbol*
+FormulaIndex::symbol(uint32_t id) const {
+    if (id & TEMPORARY_SYMBOL) {
+	if ((id & ~TEMPORARY_SYMBOL) >= BITSET_SIZE) throw unknown_object();
+	return create_temporary_symbol(id & ~TEMPORARY_SYMBOL);
+    }
+    if (id >= _symbols.size()) throw unknown_object();
+    return _symbols[id];
+}
+
+void
+ObjectWriter::clear() {
+    _buf.clear();
+    _set_moves.clear();
+    _point_moves.clear();
+    _alphas.clear();
+    _games.clear();
+}
+
+/**
+ * Writes a reference if obj was written before, otherwise marks the
+ * following definition.
+ * @return whether obj must be defined
+ */
+bool
+ObjectWriter::put_ref(ObjectIds &ids, const void *obj) {
+    if (obj == NULL) {
+	put8(OBJECT_NULL);
+	return false;
+    }
+    ObjectIds::const_iterator it = ids.find(obj);
+    if (it != ids.end()) {
+	put8(OBJECT_REF);
+	put32(it->second);
+	return false;
+    }
+    put8(OBJECT_NEW);
+    return true;
+}
+
+/* the position of a definition is the number of its predecessors of
+ * the same kind, counted when it is complete */
+void
+ObjectWriter::defined(ObjectIds &ids, const void *obj) {
+    uint32_t id = ids.size();
+    ids[obj] = id;
+}
+
+/**
+ * Write the bits of the move below its nesting depth, as
+ * serialized_move_words() words of 64 bits.
+ */
+template <typename TMove>
+void
+ObjectWriter::put_bits(const TMove *move, bool (TMove::*test)(unsigned int) const) {
+    unsigned int words = serialized_move_words();
+    for (unsigned int w = 0; w < words; w++) {
+	uint64_t bits = 0;
+	for (unsigned int i = 64 * w; i < 64 * (w + 1) && i < move->nesting_depth(); i++)
+	    if ((move->*test)(i)) bits |= 1ULL << (i - 64 * w);
+	put64(bits);
+    }
+}
+
+void
+ObjectWriter::put_move(const SetMove *move) {
+    if (!put_ref(_set_moves, move)) return;
+    put_symbol(move->symbol());
+    put_bits<SetMove>(move, &SetMove::test);
+    defined(_set_moves, move);
+}
+
+void
+ObjectWriter::put_move(const PointMove *move) {
+    if (!put_ref(_point_moves, move)) return;
+    put_symbol(move->symbol());
+    put_bits<PointMove>(move, &PointMove::test_label);
+    put_bits<PointMove>(move, &PointMove::test_edge);
+    defined(_point_moves, move);
+}
+
+/**
+ * An assignment is written as the number of its symbols, followed by
+ * the symbols and their moves by increasing nesting depth.
+ */
+void
+ObjectWriter::put_alpha(const Assignment_f *alpha) {
+    const Assignment *a = alpha->get();
+    if (!put_ref(_alphas, a)) return;
+    uint32_t n = 0;
+    for (unsigned int d = 0; d <= a->depth(); d++)
+	if (a->symbol_at(d) != NULL) n++;
+    put32(n);
+    for (unsigned int d = 0; d <= a->depth(); d++) {
+	const Symbol *s = a->symbol_at(d);
+	if (s == NULL) continue;
+	if (s->arity() == 1) {
+	    const UnarySymbol *sym = static_cast<const UnarySymbol*>(s);
+	    put8(ALPHA_SET);
+	    put_symbol(sym);
+	    put_move(a->get(sym));
+	} else {
+	    const ConstantSymbol *sym = static_cast<const ConstantSymbol*>(s);
+	    put8(ALPHA_OBJ);
+	    put_symbol(sym);
+	    put_move(a->get(sym));
+	}
+    }
+    defined(_alphas, a);
+}
+
+template <typename TGame, typename TMove>
+void
+ObjectWriter::put_q_game(const TGame *g) {
+    put_formula(g->formula());
+    typedef typename TGame::GamesContainer::GameIterator GameIterator;
+    uint32_t n = 0;
+    for (GameIterator it(g->begin(), g->end()); it.has_next(); it.next())
+	n++;
+    put32(n);
+    GameIterator it(g->begin(), g->end());
+    while (it.has_next()) {
+	std::pair<const TMove*, const MCGame_f*> sub = it.next();
+	put_move(sub.first);
+	put_game(sub.second);
+    }
+}
+
+template <typename TGame>
+void
+ObjectWriter::put_bool_comb_game(const TGame *g) {
+    put_formula(g->formula());
+    typename TGame::subgames_iterator it, itend;
+    boost::tie(it, itend) = g->subgames();
+    uint32_t n = 0;
+    for (typename TGame::subgames_iterator c = it; c != itend; ++c)
+	n++;
+    put32(n);
+    for (; it != itend; ++it) {
+	put_formula(it->first);
+	put_game(it->second);
+    }
+}
+
+void
+ObjectWriter::put_game(const MCGame_f *game) {
+    const MCGame *g = game->get();
+    if (!put_ref(_games, g)) return;
+    if (g->outcome() != MCGame::UNDETERMINED) {
+	put8(g->outcome() == MCGame::FALSIFIER ? GAME_FALSE : GAME_TRUE);
+    } else if (dynamic_cast<const AtomarUndetGame*>(g) != NULL) {
+	put8(GAME_ATOMAR);
+	put_formula(g->formula());
+    } else if (const UnivSetQUndetGame *q = dynamic_cast<const UnivSetQUndetGame*>(g)) {
+	put8(GAME_UNIV_SET);
+	put_q_game<UnivSetQUndetGame, SetMove>(q);
+    } else if (const ExistSetQUndetGame *q = dynamic_cast<const ExistSetQUndetGame*>(g)) {
+	put8(GAME_EXIST_SET);
+	put_q_game<ExistSetQUndetGame, SetMove>(q);
+    } else if (const UnivObjQUndetGame *q = dynamic_cast<const UnivObjQUndetGame*>(g)) {
+	put8(GAME_UNIV_OBJ);
+	put_q_game<UnivObjQUndetGame, PointMove>(q);
+    } else if (const ExistObjQUndetGame *q = dynamic_cast<const ExistObjQUndetGame*>(g)) {
+	put8(GAME_EXIST_OBJ);
+	put_q_game<ExistObjQUndetGame, PointMove>(q);
+    } else if (const ConjBoolCombUndetGame *b = dynamic_cast<const ConjBoolCombUndetGame*>(g)) {
+	put8(GAME_CONJ);
+	put_bool_comb_game(b);
+    } else if (const DisjBoolCombUndetGame *b = dynamic_cast<const DisjBoolCombUndetGame*>(g)) {
+	put8(GAME_DISJ);
+	put_bool_comb_game(b);
+    } else {
+	throw unknown_object();
+    }
+    defined(_games, g);
+}
+
+ObjectReader::~ObjectReader() {
+    for (unsigned int i = 0; i < _alphas.size(); i++)
+	delete _alphas[i];
+    for (unsigned int i = 0; i < _games.size(); i++)
+	delete _games[i];
+}
+
+void
+ObjectReader::read(void *v, size_t len) {
+    if ((size_t)(_end - _pos) < len) throw unknown_object();
+    ::memcpy(v, _pos, len);
+    _pos += len;
+}
+
+/**
+ * Reads a reference to an object read before (or NULL) into obj.
+ * @return false if the definition of a new object follows instead
+ */
+template <typename T>
+bool
+ObjectReader::get_ref(const std::vector<T> &objects, T &obj) {
+    uint8_t tag = get8();
+    if (tag == OBJECT_NULL) {
+	obj = NULL;
+	return true;
+    }
+    if (tag == OBJECT_REF) {
+	uint32_t id = get32();
+	if (id >= objects.size()) throw unknown_object();
+	obj = objects[id];
+	return true;
+    }
+    if (tag != OBJECT_NEW) throw unknown_object();
+    return false;
+}
+
+/**
+ * Read the bits written by ObjectWriter::put_bits() into move.
+ */
+template <typename TMove>
+void
+ObjectReader::get_bits(TMove *move, void (TMove::*add)(unsigned int)) {
+    unsigned int words = serialized_move_words();
+    for (unsigned int w = 0; w < words; w++) {
+	uint64_t bits = get64();
+	for (unsigned int i = 64 * w; bits != 0; i++, bits >>= 1) {
+	    if (!(bits & 1))
+		continue;
+	    if (i >= move->nesting_depth())
+		throw unknown_object();
+	    (move->*add)(i);
+	}
+    }
+}
+
+void
+ObjectReader::get_move(const SetMove *&move) {
+    if (get_ref(_set_moves, move)) return;
+    const UnarySymbol *sym = get_symbol<UnarySymbol>();
+    SetMove *m = new SetMove(sym);
+    try {
+	get_bits<SetMove>(m, &SetMove::add);
+    } catch (const unknown_object&) {
+	delete m;
+	throw;
+    }
+    move = moves_pool.pool(m);
+    _set_moves.push_back(move);
+}
+
+void
+ObjectReader::get_move(const PointMove *&move) {
+    if (get_ref(_point_moves, move)) return;
+    const ConstantSymbol *sym = get_symbol<ConstantSymbol>();
+    PointMove *m = new PointMove(sym);
+    try {
+	get_bits<PointMove>(m, &PointMove::add_label);
+	get_bits<PointMove>(m, &PointMove::add_edge);
+    } catch (const unknown_object&) {
+	delete m;
+	throw;
+    }
+    move = moves_pool.pool(m);
+    _point_moves.push_back(move);
+}
+
+const Assignment_f*
+ObjectReader::get_alpha() {
+    const Assignment_f *alpha;
+    if (get_ref(_alphas, alpha)) {
+	if (alpha == NULL) throw unknown_object();
+	return alpha;
+    }
+    uint32_t n = get32();
+    boost::scoped_ptr<const Assignment_f> a(AssignmentFlyFactory::make(new EmptyAssignment()));
+    for (uint32_t i = 0; i < n; i++) {
+	uint8_t kind = get8();
+	if (kind == ALPHA_SET) {
+	    const UnarySymbol *sym = get_symbol<UnarySymbol>();
+	    const SetMove *move;
+	    get_move(move);
+	    if (sym->nesting_depth() <= a->get()->depth() && i > 0)
+		throw unknown_object();
+	    a.reset(AssignmentFlyFactory::make(SetAssignment::make(a.get(), sym, move)));
+	} else if (kind == ALPHA_OBJ) {
+	    const ConstantSymbol *sym = get_symbol<ConstantSymbol>();
+	    const PointMove *move;
+	    get_move(move);
+	    if (sym->nesting_depth() <= a->get()->depth() && i > 0)
+		throw unknown_object();
+	    a.reset(AssignmentFlyFactory::make(ObjAssignment::make(a.get(), sym, move)));
+	} else {
+	    throw unknown_object();
+	}
+    }
+    alpha = a->clone();
+    _alphas.push_back(alpha);
+    return alpha;
+}
+
+template <typename TGame, typename TFormula, typename TMove>
+const MCGame_f*
+ObjectReader::get_q_game() {
+    const TFormula *f = get_formula<TFormula>();
+    uint32_t n = get32();
+    std::vector<std::pair<const TMove*, const MCGame_f*> > subgames;
+    for (uint32_t i = 0; i < n; i++) {
+	const TMove *move;
+	get_move(move);
+	const MCGame_f *game = get_game();
+	subgames.push_back(std::make_pair(move, game));
+    }
+    TGame *res = new TGame(f);
+    for (unsigned int i = 0; i < subgames.size(); i++) {
+	const MCGame_f *tmp = res->add_subgame(subgames[i].first,
+					       subgames[i].second->clone());
+	if (tmp != NULL) return tmp;
+    }
+    return res->minimize();
+}
+
+template <typename TGame, typename TFormula>
+const MCGame_f*
+ObjectReader::get_bool_comb_game() {
+    const TFormula *f = get_formula<TFormula>();
+    uint32_t n = get32();
+    std::vector<std::pair<const Formula*, const MCGame_f*> > subgames;
+    for (uint32_t i = 0; i < n; i++) {
+	const Formula *subf = get_formula();
+	const MCGame_f *game = get_game();
+	subgames.push_back(std::make_pair(subf, game));
+    }
+    TGame *res = new TGame(f);
+    for (unsigned int i = 0; i < subgames.size(); i++) {
+	const MCGame_f *tmp = res->add_subgame(subgames[i].first,
+					       subgames[i].second->clone());
+	if (tmp != NULL) return tmp;
+    }
+    return res->minimize();
+}
+
+const MCGame_f*
+ObjectReader::get_game() {
+    const MCGame_f *game;
+    if (get_ref(_games, game)) {
+	if (game == NULL) throw unknown_object();
+	return game;
+    }
+    switch (get8()) {
+    case GAME_FALSE:
+	game = determined.get(MCGame::FALSIFIER);
+	break;
+    case GAME_TRUE:
+	game = determined.get(MCGame::VERIFIER);
+	break;
+    case GAME_ATOMAR:
+	game = MCGameFlyFactory::make(new AtomarUndetGame(get_formula()));
+	break;
+    case GAME_UNIV_SET:
+	game = get_q_game<UnivSetQUndetGame, UnivSetQFormula, SetMove>();
+	break;
+    case GAME_EXIST_SET:
+	game = get_q_game<ExistSetQUndetGame, ExistSetQFormula, SetMove>();
+	break;
+    case GAME_UNIV_OBJ:
+	game = get_q_game<UnivObjQUndetGame, UnivObjQFormula, PointMove>();
+	break;
+    case GAME_EXIST_OBJ:
+	game = get_q_game<ExistObjQUndetGame, ExistObjQFormula, PointMove>();
+	break;
+    case GAME_CONJ:
+	game = get_bool_comb_game<ConjBoolCombUndetGame, ConjBoolCombFormula>();
+	break;
+    case GAME_DISJ:
+	game = get_bool_comb_game<DisjBoolCombUndetGame, DisjBoolCombFormula>();
+	break;
+    default:
+	throw unknown_object();
+    }
+    _games.push_back(game);
+    return game;
+}
+
+} // namespace
@@ -0,0 +1,190 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_OBJECT_SERIALIZER_H
+#define	SEQUOIA_OBJECT_SERIALIZER_H
+
+#include "game.h"
+#include "unordered_defs.h"
+#include "logic/assignment.h"
+#include "logic/formula.h"
+
+#include <boost/type_traits/is_same.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace sequoia {
+
+/**
+ * Thrown if an object refers to something we cannot write, e.g., a
+ * formula that is not part of the solved formula, or if the data read
+ * does not fit the formula.
+ */
+struct unknown_object { };
+
+/**
+ * Numbers the subformulas of the solved formula in preorder and the
+ * symbols of their vocabularies in order of appearance.  Both numberings
+ * only depend on the formula and the vocabulary, not on the run.
+ */
+class FormulaIndex {
+public:
+    explicit FormulaIndex(const Formula *root);
+
+    /**
+     * Describes the formula and its symbols, data written for another
+     * formula must not be read.
+     */
+    const std::string& fingerprint() const { return _fingerprint; }
+
+    uint32_t formula_id(const Formula *f) const {
+	FormulaIds::const_iterator it = _formula_ids.find(f);
+	if (it == _formula_ids.end()) throw unknown_object();
+	return it->second;
+    }
+    const Formula* formula(uint32_t id) const {
+	if (id >= _formulas.size()) throw unknown_object();
+	return _formulas[id];
+    }
+    uint32_t symbol_id(const Symbol *s) const {
+	SymbolIds::const_iterator it = _symbol_ids.find(s);
+	if (it == _symbol_ids.end()) throw unknown_object();
+	return it->second;
+    }
+    const Symbol* symbol(uint32_t id) const;
+private:
+    friend class FormulaIndexBuilder;
+    typedef SEQUOIA_UNORDERED_MAP<const Formula*, uint32_t> FormulaIds;
+    typedef SEQUOIA_UNORDERED_MAP<const Symbol*, uint32_t> SymbolIds;
+    std::vector<const Formula*> _formulas;
+    std::vector<const Symbol*> _symbols;
+    FormulaIds _formula_ids;
+    SymbolIds _symbol_ids;
+    std::string _fingerprint;
+};
+
+/**
+ * Serializes moves, assignments and games into a buffer.  Formulas and
+ * symbols are written by their position in the FormulaIndex, so the data
+ * does not depend on the memory layout of the run that wrote it.  Each
+ * move, assignment and game is written once and referred to by its
+ * position afterwards, until clear() is called.  Integers are written in
+ * the byte order of the machine.
+ */
+class ObjectWriter {
+public:
+    explicit ObjectWriter(const FormulaIndex &index) : _index(index) { }
+    const std::string& buffer() const { return _buf; }
+    /**
+     * Empty the buffer and forget the objects written.
+     */
+    void clear();
+
+    void put8(uint8_t v) { _buf.push_back((char)v); }
+    void put32(uint32_t v) { _buf.append((const char*)&v, sizeof(v)); }
+    void put64(uint64_t v) { _buf.append((const char*)&v, sizeof(v)); }
+    void put_formula(const Formula *f) { put32(_index.formula_id(f)); }
+    void put_symbol(const Symbol *s) { put32(_index.symbol_id(s)); }
+    void put_alpha(const Assignment_f *alpha);
+    void put_game(const MCGame_f *game);
+
+private:
+    typedef SEQUOIA_UNORDERED_MAP<const void*, uint32_t> ObjectIds;
+
+    bool put_ref(ObjectIds &ids, const void *obj);
+    void defined(ObjectIds &ids, const void *obj);
+    void put_move(const SetMove *move);
+    void put_move(const PointMove *move);
+    template <typename TMove>
+    void put_bits(const TMove *move, bool (TMove::*test)(unsigned int) const);
+    template <typename TGame, typename TMove> void put_q_game(const TGame *g);
+    template <typename TGame> void put_bool_comb_game(const TGame *g);
+
+    const FormulaIndex &_index;
+    std::string _buf;
+    ObjectIds _set_moves;
+    ObjectIds _point_moves;
+    ObjectIds _alphas;
+    ObjectIds _games;
+};
+
+/**
+ * Reconstructs the objects written by an ObjectWriter.  Moves are pooled,
+ * assignments and games are re-interned as flyweights; they are owned by
+ * the reader and released when the reader is destroyed, so clone them
+ * to keep them.  Malformed data raises unknown_object.
+ */
+class ObjectReader {
+public:
+    ObjectReader(const FormulaIndex &index, const char *data, size_t len)
+    : _index(index), _pos(data), _end(data + len) { }
+    ~ObjectReader();
+
+    uint8_t get8() { uint8_t v; read(&v, sizeof(v)); return v; }
+    uint32_t get32() { uint32_t v; read(&v, sizeof(v)); return v; }
+    uint64_t get64() { uint64_t v; read(&v, sizeof(v)); return v; }
+    bool at_end() const { return _pos == _end; }
+    void check_end() const { if (_pos != _end) throw unknown_object(); }
+
+    const Formula* get_formula() { return _index.formula(get32()); }
+    template <typename TFormula> const TFormula* get_formula() {
+	const TFormula *f = dynamic_cast<const TFormula*>(get_formula());
+	if (f == NULL) throw unknown_object();
+	return f;
+    }
+    template <typename TSymbol> const TSymbol* get_symbol() {
+	const Symbol *s = _index.symbol(get32());
+	if (s->arity() != (boost::is_same<TSymbol, UnarySymbol>::value ? 1 : 0))
+	    throw unknown_object();
+	return static_cast<const TSymbol*>(s);
+    }
+    const Assignment_f* get_alpha();
+    const MCGame_f* get_game();
+
+private:
+    ObjectReader(const ObjectReader&);
+    ObjectReader& operator=(const ObjectReader&);
+
+    void read(void *v, size_t len);
+    template <typename T> bool get_ref(const std::vector<T> &objects, T &obj);
+    void get_move(const SetMove *&move);
+    void get_move(const PointMove *&move);
+    template <typename TMove>
+    void get_bits(TMove *move, void (TMove::*add)(unsigned int));
+    template <typename TGame, typename TFormula, typename TMove>
+    const MCGame_f* get_q_game();
+    template <typename TGame, typename TFormula>
+    const MCGame_f* get_bool_comb_game();
+
+    const FormulaIndex &_index;
+    const char *_pos;
+    const char *_end;
+    std::vector<const SetMove*> _set_moves;
+    std::vector<const PointMove*> _point_moves;
+    std::vector<const Assignment_f*> _alphas;
+    std::vector<const MCGame_f*> _games;
+};
+
+} // namespace
+
+#endif	// SEQUOIA_OBJECT_SERIALIZER_H
@@ -25,6 +25,10 @@
 #include "hashing.h"
 #include "unordered_defs.h"
 
+#ifndef HAVE_TBB
+#include <mutex>
+#endif
+
 namespace sequoia {
 
 template <typename T> class Pool {
@@ -37,8 +41,14 @@ public:
     }
     const T* pooling(const T* inptr) {
         assert(inptr != NULL);
+#ifndef HAVE_TBB
+        std::unique_lock<std::mutex> lock(_mutex);
+#endif
         std::pair<typename PoolSet::iterator, bool> res = _pool.insert(inptr);
 	const T* resptr = *res.first;
+#ifndef HAVE_TBB
+        lock.unlock();
+#endif
         if (res.second) { // new
 #ifdef POOLING_DEBUG
             DPRINTLN("[Pool<" << typeid(T).name() << "> new " << inptr << "]");
@@ -60,6 +70,9 @@ private:
         ptr_deep_equals<const T*>
     > PoolSet;
     PoolSet _pool;
+#ifndef HAVE_TBB
+    std::mutex _mutex;
+#endif
 };
 
 } // namespace
@@ -19,6 +19,7 @@
 /**
  * @author Alexander Langer
  */
+#include "cache_control.h"
 #include "exceptions.h"
 #include "sequoia_app.h"
 #include "structures/graph_printer.h"
@@ -40,18 +41,27 @@ SequoiaSolverApp::SequoiaSolverApp() :
     _treedecomposition(NULL),
     _formula(NULL),
     _cache_size(NULL),
+    _cache_file(NULL),
     _solution(NULL),
     _2flag(false),
-    _threads(0) {
+    _threads(0),
+    _policy(NULL),
+    _reclamation(NULL),
+    _eviction(NULL),
+    _memory_budget(NULL),
+    _spill_directory(NULL) {
 }
 
 void SequoiaSolverApp::init(int argc, char **argv) {
     int ch;
-    while ((ch = getopt(argc, argv, "c:f:e:g:t:T:2s:")) != -1) {
+    while ((ch = getopt(argc, argv, "c:C:f:e:g:t:T:p:R:E:M:S:2s:")) != -1) {
         switch (ch) {
         case 'c':
             _cache_size = optarg;
             break;
+        case 'C':
+            _cache_file = optarg;
+            break;
         case 'f':
             _formula = optarg;
             break;
@@ -73,6 +83,21 @@ void SequoiaSolverApp::init(int argc, char **argv) {
         case 'T':
             _threads = atoi(optarg);
             break;
+        case 'p':
+            _policy = optarg;
+            break;
+        case 'R':
+            _reclamation = optarg;
+            break;
+        case 'E':
+            _eviction = optarg;
+            break;
+        case 'M':
+            _memory_budget = optarg;
+            break;
+        case 'S':
+            _spill_directory = optarg;
+            break;
         case '?':
             usage();
             exit(EXIT_SUCCESS);
@@ -112,20 +137,46 @@ int SequoiaSolverApp::run() {
 #ifdef HAVE_TBB
     tbb::task_scheduler_init task_sched_init(-2);
     if (_threads > 0) {
-	//if (_threads > 4) _threads = 4;
     	std::cout << "Limiting to " << _threads << " threads." << std::endl;
 	task_sched_init.initialize(_threads);
     } else {
-	int num = tbb::task_scheduler_init::default_num_threads();
-	if (num > 4) {
-    	    std::cout << "Threading library wants to schedule " << num << " threads, limiting to 4." << std::endl;
-		task_sched_init.initialize(4);
-	} else {
-	    task_sched_init.initialize(-1);
-        }
+	task_sched_init.initialize(-1);
     }
 #endif
     SequoiaSolver solver;
+#ifndef HAVE_TBB
+    if (_threads > 0) {
+    	std::cout << "Limiting to " << _threads << " threads." << std::endl;
+	solver.threads(_threads);
+    }
+#endif
+    if (_policy != NULL) {
+	try {
+	    solver.scheduling_policy(scheduling_policy_from_string(_policy));
+	} catch (const std::exception &e) {
+	    std::cerr << "ERROR:  " << e.what() << std::endl;
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
+    }
+    if (_memory_budget != NULL) {
+	try {
+	    solver.memory_budget(memory_size_from_string(_memory_budget));
+	} catch (const std::exception &e) {
+	    std::cerr << "ERROR:  " << e.what() << std::endl;
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
+    }
+    if (_reclamation != NULL) {
+	if (std::string(_reclamation) == "deferred") {
+	    solver.deferred_reclamation(true);
+	} else if (std::string(_reclamation) != "immediate") {
+	    std::cerr << "ERROR:  Unknown reclamation mode: " << _reclamation << std::endl;
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
+    }
 
     try {
 	solver.load_graph(_graph);
@@ -147,11 +198,35 @@ int SequoiaSolverApp::run() {
     }
     
     if (_cache_size != NULL) {
-        long s = atol(_cache_size);
-        solver.cache_size(s);
+	try {
+	    solver.cache_bytes(memory_size_from_string(_cache_size));
+	} catch (const std::exception &e) {
+	    std::cerr << "ERROR:  " << e.what() << std::endl;
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
+    }
+    if (_eviction != NULL) {
+	try {
+	    solver.cache_eviction(cache_eviction_policy_from_string(_eviction));
+	} catch (const std::exception &e) {
+	    std::cerr << "ERROR:  " << e.what() << std::endl;
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
     }
 
-    solver.solve();
+    if (_cache_file != NULL)
+	solver.cache_file(_cache_file);
+    if (_spill_directory != NULL)
+	solver.spill_directory(_spill_directory);
+
+    try {
+	solver.solve();
+    } catch (const sequoia_file_error &e) {
+	std::cerr << "ERROR:  " << e.what() << std::endl;
+	exit(EXIT_FAILURE);
+    }
 
     std::cout << "Solution:" << std::endl;
     if(solver.has_solution()) {
@@ -190,10 +265,21 @@ void SequoiaSolverApp::usage() {
     std::cerr << "\t -2 \t\t\tuse the incidence graph model" << std::endl;
     std::cerr << "\t -s <solution graph>\twrite annotated graph to file" << std::endl;
     std::cerr << "Performance options:" << std::endl;
-#ifdef HAVE_TBB
     std::cerr << "\t -T <num>\t\tlimit to <num> parallel threads" << std::endl;
-#endif
-    std::cerr << "\t -c <size>>\t\tcache expensive computations using caches of size <size>" << std::endl;
+    std::cerr << "\t -p <all,socket>\tscheduling policy: use all cores (default), or" << std::endl;
+    std::cerr << "\t\t\t\tpin threads and subtrees to NUMA nodes" << std::endl;
+    std::cerr << "\t -R <immediate,deferred>\trelease unused games one by one (default)," << std::endl;
+    std::cerr << "\t\t\t\tor in bulk when a table is freed" << std::endl;
+    std::cerr << "\t -M <size>{K,M,G}\tonce the tables take <size> bytes of memory," << std::endl;
+    std::cerr << "\t\t\t\tcomplete subtrees one after another" << std::endl;
+    std::cerr << "\t -S <directory>\t\tmove tables waiting for a join to files in" << std::endl;
+    std::cerr << "\t\t\t\t<directory> (with -M: once <size> is reached)" << std::endl;
+    std::cerr << "\t -c <size>{K,M,G}\tcache expensive computations using <size> bytes" << std::endl;
+    std::cerr << "\t\t\t\tof memory (default 32M)" << std::endl;
+    std::cerr << "\t -E <lru,clock>\t\tcache eviction: least recently used (default), or" << std::endl;
+    std::cerr << "\t\t\t\tthe CLOCK approximation (cheaper hits)" << std::endl;
+    std::cerr << "\t -C <file>\t\tkeep cached computations in <file> and reuse" << std::endl;
+    std::cerr << "\t\t\t\tthem in later runs on the same formula" << std::endl;
 }
 
 } // namespace
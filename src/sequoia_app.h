@@ -39,8 +39,14 @@ private:
     const char *_formula;
     const char *_solution;
     const char *_cache_size;
+    const char *_cache_file;
     bool _2flag;
     int _threads;
+    const char *_policy;
+    const char *_reclamation;
+    const char *_eviction;
+    const char *_memory_budget;
+    const char *_spill_directory;
 };
 
 } // namespace
@@ -29,8 +29,8 @@
 #include <tbb/concurrent_vector.h>
 #define CONCUR_VECTOR tbb::concurrent_vector
 #else
-#include <vector>
-#define CONCUR_VECTOR std::vector
+#include "locked_vector.h"
+#define CONCUR_VECTOR LockedVector
 #endif
 
 namespace sequoia {
@@ -30,7 +30,8 @@
 #include <tbb/concurrent_vector.h>
 #define CONCUR_VECTOR tbb::concurrent_vector
 #else
-#define CONCUR_VECTOR std::vector
+#include "locked_vector.h"
+#define CONCUR_VECTOR LockedVector
 #endif
 
 using namespace sequoia;
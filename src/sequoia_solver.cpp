@@ -32,10 +32,15 @@
 #include "apply_join.h"
 #include "apply_root.h"
 #include "cache_control.h"
+#include "cache_persistent.h"
 #include "exceptions.h"
+#include "flyweight.h"
 #include "incidence_graph.h"
+#include "object_serializer.h"
+#include "table_spill.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include <boost/scoped_ptr.hpp>
 
@@ -53,32 +58,125 @@ SequoiaSolver::~SequoiaSolver() {
 	if (_alphas[i] != NULL) 
 	    delete _alphas[i];
     }
+    for (unsigned int i = 0; i < _spills.size(); i++)
+	delete _spills[i];
+    delete _spill_index;
     delete _evaluation;
     if (_orig_graph != _graph)
         delete _orig_graph;
     delete _graph;
 }
 
-void SequoiaSolver::cache_size(size_t size) { 
-    cache_resize(size);
+void SequoiaSolver::cache_bytes(size_t max_bytes) {
+    cache_resize(max_bytes);
+}
+
+void SequoiaSolver::cache_eviction(CacheEvictionPolicy policy) {
+    sequoia::cache_eviction(policy);
 }
         
+namespace {
+
+/**
+ * Computes the maximum number of nested quantifiers of a formula.
+ */
+class QuantifierDepthVisitor : public FormulaVisitor {
+public:
+    QuantifierDepthVisitor() : _depth(0) { }
+    void visit(const UnivSetQFormula* f) { visit_q(f); }
+    void visit(const ExistSetQFormula* f) { visit_q(f); }
+    void visit(const UnivObjQFormula* f) { visit_q(f); }
+    void visit(const ExistObjQFormula* f) { visit_q(f); }
+    void visit(const ConjBoolCombFormula* f) { visit_bool_comb(f); }
+    void visit(const DisjBoolCombFormula* f) { visit_bool_comb(f); }
+    void visit(const AtomarFormulaMember* f) { _depth = 0; }
+    void visit(const AtomarFormulaAdj* f) { _depth = 0; }
+    void visit(const AtomarFormulaEquals* f) { _depth = 0; }
+    void visit(const NegatedFormula* f) { _depth = 0; }
+    unsigned int get() const { return _depth; }
+private:
+    void visit_q(const QFormula* f) {
+        (*f->subformulas_begin())->accept(this);
+        _depth++;
+    }
+    void visit_bool_comb(const BoolCombFormula* f) {
+        unsigned int depth = 0;
+        BoolCombFormula::subformula_iterator it;
+        for (it = f->subformulas_begin(); it != f->subformulas_end(); ++it) {
+            (*it)->accept(this);
+            depth = std::max(depth, _depth);
+        }
+        _depth = depth;
+    }
+    unsigned int _depth;
+};
+
+} // namespace
+
 void SequoiaSolver::pre_solve() {
+    if (_formula == NULL)
+	throw sequoia_usage_error("No formula loaded.");
+    QuantifierDepthVisitor qdepth;
+    _formula->accept(&qdepth);
+    _quantifier_depth = qdepth.get();
     DynProgSolver::pre_solve();
     _has_solution = false;
     assert(_evaluation != NULL);
     _tables.resize(treedecomposition()->num_vertices());
     _alphas.resize(treedecomposition()->num_vertices());
+    // flyweights are released in bulk in cleanup()
+    if (_deferred_reclamation)
+        flyweight_deferred_reclamation(true);
     for (unsigned int i = 0; i < treedecomposition()->num_vertices(); i++) {
         _tables[i] = new SequoiaTable(treedecomposition(), i, _evaluation);
 	_alphas[i] = NULL;
     }
+    if (!_spill_directory.empty()) {
+	const TreeDecomposition* tdc = treedecomposition();
+	delete _spill_index;
+	_spill_index = new FormulaIndex(_formula);
+	_spills.assign(tdc->num_vertices(), NULL);
+	_completed.assign(tdc->num_vertices(), false);
+	_join_partner.resize(tdc->num_vertices());
+	for (unsigned int i = 0; i < tdc->num_vertices(); i++)
+	    _join_partner[i] = i;
+	for (unsigned int i = 0; i < tdc->num_vertices(); i++) {
+	    if (tdc->out_degree(i) != 2)
+		continue;
+	    TreeDecomposition::out_edge_iterator o, oend;
+	    boost::tie(o, oend) = tdc->out_edges(i);
+	    TreeDecomposition::vertex_descriptor left = tdc->target(*o++);
+	    TreeDecomposition::vertex_descriptor right = tdc->target(*o++);
+	    _join_partner[left] = right;
+	    _join_partner[right] = left;
+	}
+    }
+    if (!_cache_file.empty()) {
+	size_t loaded = cache_persistent_open(_cache_file, _formula);
+	std::cout << "Loaded " << loaded << " cache entries from "
+		  << _cache_file << std::endl;
+    }
 
     _periodic = new PeriodicJob(this);
     boost::thread thread(*_periodic);
     log_status();
 }
 
+/**
+ * Each quantifier ranges over the subsets of (resp. elements of) the
+ * bag, so the number of games at t grows roughly like
+ * 2^(width * quantifier depth).
+ */
+double
+SequoiaSolver::node_cost(const TreeDecomposition::vertex_descriptor& t) const {
+    const TreeDecomposition* tdc = treedecomposition();
+    int exponent = tdc->bag(t)->width() * std::max(_quantifier_depth, 1U);
+    double cost = std::ldexp(1.0, std::min(exponent, 1000));
+    if (tdc->out_degree(t) == 2)
+        cost *= 2.0; // joins combine the games of both children
+    return cost;
+}
+
 void SequoiaSolver::load_graph(const char* filename) {
     try {
 	_orig_graph = GraphStructureFactory::load(filename);
@@ -110,18 +208,6 @@ void SequoiaSolver::setup_formula_vocabulary() {
     if (treedecomposition() == NULL)
         generate_treedecomposition();
 
-    boost::scoped_ptr<const Assignment_f> alpha(AssignmentFlyFactory::make(new EmptyAssignment()));
-    for (unsigned int i = 0; i < _graph->num_labels(); i++) {
-        const UnarySymbol* s = _graph->label(i);
-        std::cout << "Found bound variable '"
-                << s->identifier() << "' at depth "
-                    << s->nesting_depth()
-                    << std::endl;
-        const SetMove *smove = moves_pool.pool(new SetMove(s));
-        alpha.reset(AssignmentFlyFactory::make(new SetAssignment(alpha.get(), s, smove)));
-    }
-    _base_alpha = alpha->clone();
-
     int width = treedecomposition()->width();
     std::cout << "Adding constant symbols t0 ... t"
             << (width-1) << " to vocabulary..." << std::endl;
@@ -154,9 +240,19 @@ void SequoiaSolver::load_formula(const char *source,
         throw sequoia_formula_error("Formula has free constant symbols.");
     if (fvoc->size() >= BITSET_SIZE) {
         std::stringstream s;
-        s << "Too many symbols. Cannot handle more than " << BITSET_SIZE << ".";
+        s << "Too many symbols. Cannot handle more than " << BITSET_SIZE
+          << ", rebuild with a larger SEQUOIA_MAX_MOVE_WORDS.";
         throw sequoia_formula_error(s.str());
     }
+    // use the narrowest moves of 1, 2, 4, ... words that fit
+    unsigned int words = 1;
+    while (words * MOVE_WORD_BITS <= fvoc->size())
+        words *= 2;
+    if (words > SEQUOIA_MAX_MOVE_WORDS)
+        words = SEQUOIA_MAX_MOVE_WORDS;
+    set_move_words(words);
+    if (move_words() > 1)
+        std::cout << "Using moves of " << move_words() << " words." << std::endl;
     this->finalize_formula_vocabulary();
 }
 
@@ -171,6 +267,19 @@ void SequoiaSolver::load_formula(const char* filename) {
 }
 
 void SequoiaSolver::finalize_formula_vocabulary() {
+    // the moves must not be created before the width is chosen
+    boost::scoped_ptr<const Assignment_f> alpha(AssignmentFlyFactory::make(new EmptyAssignment()));
+    for (unsigned int i = 0; i < _graph->num_labels(); i++) {
+        const UnarySymbol* s = _graph->label(i);
+        std::cout << "Found bound variable '"
+                << s->identifier() << "' at depth "
+                    << s->nesting_depth()
+                    << std::endl;
+        const SetMove *smove = moves_pool.pool(new SetMove(s));
+        alpha.reset(AssignmentFlyFactory::make(SetAssignment::make(alpha.get(), s, smove)));
+    }
+    _base_alpha = alpha->clone();
+
     const Vocabulary* fvoc = _formula->vocabulary();
     for (unsigned int i = _vocabulary->number_of_unary_symbols();
             i < fvoc->number_of_unary_symbols(); ++i) {
@@ -201,6 +310,7 @@ SequoiaSolver::do_leaf(const TreeDecomposition::vertex_descriptor& t) {
     ApplyLeaf<SequoiaSolver> apply(this, t);
     apply.init();
     apply();
+    table_completed(t);
     log_node_completed(t);
 }
 
@@ -214,6 +324,7 @@ SequoiaSolver::do_introduce(const TreeDecomposition::vertex_descriptor& child,
     ApplyIntroduce<SequoiaSolver> apply(this, t, child);
     apply.init();
     apply();
+    table_completed(t);
     cleanup(child);
     log_node_completed(t);
 }
@@ -228,6 +339,7 @@ SequoiaSolver::do_forget(const TreeDecomposition::vertex_descriptor& child,
     ApplyForget<SequoiaSolver> apply(this, t, child);
     apply.init();
     apply();
+    table_completed(t);
     cleanup(child);
     log_node_completed(t);
 }
@@ -240,9 +352,12 @@ SequoiaSolver::do_join(const TreeDecomposition::vertex_descriptor& left,
     DPRINTLN("############# JOIN ##################################");
     DPRINTLN("#####################################################");
     log_node_started(t);
+    restore(left);
+    restore(right);
     ApplyJoin<SequoiaSolver> apply(this, t, left, right);
     apply.init();
     apply();
+    table_completed(t);
     cleanup(left);
     cleanup(right);
     log_node_completed(t);
@@ -265,18 +380,99 @@ SequoiaSolver::do_root(const TreeDecomposition::vertex_descriptor& t) {
 }
 
 void SequoiaSolver::post_solve() {
+    if (_deferred_reclamation) {
+        flyweight_collect(true);
+        flyweight_deferred_reclamation(false);
+    }
     std::cout << std::endl;
+    log_cache_statistics();
+    cache_persistent_close();
+}
+
+/**
+ * Account for the memory of t's table until it is freed in cleanup().
+ */
+void SequoiaSolver::table_completed(const TreeDecomposition::vertex_descriptor& t) {
+    _table_memory += _tables[t]->allocated();
+    if (waits_for_join(t))
+	spill(t);
+}
+
+/**
+ * Whether t's table should be spilled:  its join partner has not
+ * completed yet, so the join cannot start before the partner's subtree
+ * is done.  The partner's task completes only after our spill(), so
+ * the join never sees a table being spilled.
+ */
+bool
+SequoiaSolver::waits_for_join(const TreeDecomposition::vertex_descriptor& t) {
+    if (_spill_directory.empty() || _join_partner[t] == t)
+	return false;
+    boost::lock_guard<boost::mutex> lock(_spill_mutex);
+    _completed[t] = true;
+    if (_completed[_join_partner[t]])
+	return false;
+    return memory_budget() == 0 || memory_exhausted();
+}
+
+/**
+ * Move t's table to a spill file, leaving an empty table behind.
+ */
+void SequoiaSolver::spill(const TreeDecomposition::vertex_descriptor& t) {
+    TableSpill *spill = NULL;
+    try {
+	spill = new TableSpill(_spill_directory, *_spill_index);
+	spill->write(_tables[t]);
+    } catch (const unknown_object&) {
+	// refers to objects we cannot write, keep the table
+	delete spill;
+	return;
+    } catch (const sequoia_file_error &e) {
+	// e.g., the disk is full; the table is still intact, so we keep
+	// it and carry on, only slower
+	delete spill;
+	boost::lock_guard<boost::mutex> lock(_spill_mutex);
+	if (!_spill_failed)
+	    std::cerr << "WARNING:  " << e.what()
+		      << ", keeping the tables in memory." << std::endl;
+	_spill_failed = true;
+	return;
+    }
+    _table_memory -= _tables[t]->allocated();
+    delete _tables[t];
+    _tables[t] = new SequoiaTable(treedecomposition(), t, _evaluation);
+    _spills[t] = spill;
+    if (_deferred_reclamation)
+        flyweight_collect();
+}
+
+/**
+ * Read t's table back if it was spilled.
+ */
+void SequoiaSolver::restore(const TreeDecomposition::vertex_descriptor& t) {
+    if (_spills.empty() || _spills[t] == NULL)
+	return;
+    _spills[t]->read(_tables[t]);
+    delete _spills[t];
+    _spills[t] = NULL;
+    _table_memory += _tables[t]->allocated();
 }
 
 void SequoiaSolver::cleanup(const TreeDecomposition::vertex_descriptor& t) {
     SequoiaTable *tab = _tables[t];
     SequoiaTable::const_iterator it;
+    _table_memory -= tab->allocated();
     delete tab;
     _tables[t] = NULL;
     if (_alphas[t] != NULL) {
 	delete _alphas[t];
 	_alphas[t] = NULL;
     }
+    // release the flyweights that were only referenced by this table
+    if (_deferred_reclamation)
+        flyweight_collect();
+    // give the caches' memory to those that profit most
+    cache_rebalance();
 }
 
 const GraphStructure *
@@ -334,19 +530,13 @@ SequoiaSolver::log_games_completed(size_t num) {
 void
 SequoiaSolver::print_usage() {
 #if HAVE_BOOST_TIMER
-#ifdef HAVE_TBB
     std::cout << _cpu_timer.format(1, "%ws [%us+%ss=%p%]");
-#else
-    std::cout << _cpu_timer.format(1, "%ws [%us=%p%]");
-#endif // HAVE_TBB
 #else
     struct rusage usage;
     getrusage(RUSAGE_SELF, &usage);
     std::cout << "CPU: ";
     std::cout << usage.ru_utime.tv_sec << "s user ";
-#ifdef HAVE_TBB
     std::cout << usage.ru_stime.tv_sec << "s system ";
-#endif // HAVE_TBB
 #endif // HAVE_BOOST_TIMER
 }
 
@@ -356,11 +546,28 @@ SequoiaSolver::log_status() {
     std::cout << std::endl;
     std::cout << "Node " << _nodes_started
         << "/" << tdc->num_vertices()
-	<< " game " << _games_completed << " ";
+	<< " game " << _games_completed
+	<< " tables " << (_table_memory >> 20) << "M ";
     print_usage();
+    std::cout << " cache hits F ";
+    cache_forget_statistics().print_summary(std::cout);
+    std::cout << " I ";
+    cache_introduce_statistics().print_summary(std::cout);
+    std::cout << " J ";
+    cache_join_statistics().print_summary(std::cout);
     std::cout << std::flush;
 }
 
+void
+SequoiaSolver::log_cache_statistics() {
+    std::cout << "Forget cache:" << std::endl;
+    cache_forget_statistics().print(std::cout);
+    std::cout << "Introduce cache:" << std::endl;
+    cache_introduce_statistics().print(std::cout);
+    std::cout << "Join cache:" << std::endl;
+    cache_join_statistics().print(std::cout);
+}
+
 void
 SequoiaSolver::log_periodic() {
     if (_skip_periodic) {
@@ -37,17 +37,24 @@
 #ifdef HAVE_TBB
 #include <tbb/mutex.h>
 #include <tbb/atomic.h>
+#else
+#include <atomic>
 #endif
 
 namespace sequoia {
 
+class FormulaIndex;
+class TableSpill;
+
 class SequoiaSolver : public DynProgSolver {
 public:
     SequoiaSolver()
-    : _graph(NULL), _formula(NULL), _evaluation(NULL),
-      _create_incidence_graph(false), _solution(NULL) {
+    : _create_incidence_graph(false), _deferred_reclamation(false),
+      _graph(NULL), _formula(NULL), _quantifier_depth(0), _evaluation(NULL),
+      _spill_index(NULL), _spill_failed(false), _solution(NULL) {
         // TBB requires late init
         _nodes_started = _nodes_printed = _games_completed = 0UL;
+        _table_memory = 0UL;
     }
     virtual ~SequoiaSolver();
 
@@ -60,7 +67,23 @@ public:
     virtual void formula(const std::string &formula);
     virtual void load_evaluation(const std::string &name);
 
-    void cache_size(size_t cache_size);
+    /**
+     * Set the memory budget of the caches in bytes.
+     */
+    void cache_bytes(size_t max_bytes);
+    void cache_eviction(CacheEvictionPolicy policy);
+    /**
+     * Keep the cache entries in the given file, to be reused by later
+     * runs on the same formula (see cache_persistent_open()).
+     */
+    void cache_file(const std::string &path) { _cache_file = path; }
+    /**
+     * Move the tables of finished subtrees that wait for their join
+     * partner to temporary files in the given directory, and read them
+     * back for the join.  With a memory budget, tables are only moved
+     * once the budget is exhausted.
+     */
+    void spill_directory(const std::string &dir) { _spill_directory = dir; }
 
     /* virtual void solve(); // in DynProgSolver */
 
@@ -77,6 +100,14 @@ public:
 
     /* internal interface for algorithms */
 
+    /**
+     * Release unreferenced games and assignments in bulk whenever a
+     * table is freed instead of one by one (see
+     * flyweight_deferred_reclamation()).  Pays off with many threads,
+     * where the per-object pool locking is contended.
+     */
+    void deferred_reclamation(bool flag) { _deferred_reclamation = flag; }
+    bool deferred_reclamation() const { return _deferred_reclamation; }
     const Formula* formula() const { return _formula; }
     void formula(const Formula* formula) { this->_formula = formula; }
     SequoiaInternalEvaluation* evaluation() const { return _evaluation; }
@@ -103,16 +134,22 @@ public:
     const Assignment_f * alpha(const TreeDecomposition::vertex_descriptor& t) const {
 	return this->_alphas[t];
     }
+    virtual size_t table_memory() const { return _table_memory; }
 
     void log_node_started(const TreeDecomposition::vertex_descriptor& t);
     void log_games_completed(size_t num);
     void log_node_completed(const TreeDecomposition::vertex_descriptor& t);
     void log_periodic();
     void log_status();
+    /**
+     * Print the caches' counters by formula height.
+     */
+    void log_cache_statistics();
 
 protected:
     virtual void pre_solve();
     virtual void post_solve();
+    virtual double node_cost(const TreeDecomposition::vertex_descriptor& t) const;
 
     virtual void setup_graph();
     virtual void load_formula(const char *source,
@@ -133,22 +170,38 @@ protected:
                  const TreeDecomposition::vertex_descriptor& t);
 
 private:
+    void table_completed(const TreeDecomposition::vertex_descriptor &t);
+    bool waits_for_join(const TreeDecomposition::vertex_descriptor &t);
+    void spill(const TreeDecomposition::vertex_descriptor &t);
+    void restore(const TreeDecomposition::vertex_descriptor &t);
     void cleanup(const TreeDecomposition::vertex_descriptor &t);
 
     const GraphStructure *_orig_graph;
     bool _create_incidence_graph;
+    bool _deferred_reclamation;
     const GraphStructure *_graph;
     const Formula* _formula;
+    unsigned int _quantifier_depth;
     SequoiaInternalEvaluation *_evaluation;
 
     Vocabulary* _vocabulary;  // vocabulary annotated with new symbols
     std::vector<const ConstantSymbol*> _terminal_symbols;
     std::vector<const UnarySymbol*> _free_unary_symbols;
     const Assignment_f *_base_alpha;
+    std::string _cache_file;
 
     std::vector<SequoiaTable*> _tables;
     std::vector<const Assignment_f*> _alphas;
 
+    std::string _spill_directory;
+    FormulaIndex* _spill_index;
+    std::vector<TableSpill*> _spills;
+    // the other child of the join node above, or the node itself
+    std::vector<TreeDecomposition::vertex_descriptor> _join_partner;
+    std::vector<bool> _completed;
+    boost::mutex _spill_mutex;
+    bool _spill_failed; // warned that spilling failed
+
     const void* _solution;
     bool _has_solution;
 
@@ -156,10 +209,12 @@ private:
     tbb::atomic<size_t> _nodes_started;
     tbb::atomic<size_t> _nodes_printed;
     tbb::atomic<size_t> _games_completed;
+    tbb::atomic<size_t> _table_memory;
 #else
-    size_t _nodes_started;
-    size_t _nodes_printed;
-    size_t _games_completed;
+    std::atomic<size_t> _nodes_started;
+    std::atomic<size_t> _nodes_printed;
+    std::atomic<size_t> _games_completed;
+    std::atomic<size_t> _table_memory;
 #endif
     void print_usage();
     class PeriodicJob {
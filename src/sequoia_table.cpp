@@ -32,15 +32,46 @@ SequoiaTable::update_value(const Assignment_f* alpha,
 	delete game;
 	return;
     }
-    GameVoidPtrMap *map = new GameVoidPtrMap();
-    const Assignment_f *my_alpha = alpha->clone();
-    std::pair<Container::iterator, bool> res = _container.insert(std::make_pair(my_alpha, map));
-    if (!res.second) { // entry exists already
-	delete my_alpha;
-	delete map;
+    map(alpha)->update_value(game, val, _evaluation);
+}
+
+void
+SequoiaTable::update_value_borrowed(const Assignment_f* alpha,
+				    const MCGame_f* game,
+				    const void *val) {
+    assert(game != NULL);
+    if (game->get()->outcome() == MCGame::FALSIFIER)
+	return;
+    map(alpha)->update_value_borrowed(game, val, _evaluation);
+}
+
+GameVoidPtrMap*
+SequoiaTable::map(const Assignment_f* alpha) {
+    Container::value_type *res = _container.find(alpha);
+    if (res == NULL) {
+	GameVoidPtrMap *map = new (_arena.allocate(sizeof(GameVoidPtrMap),
+						   __alignof__(GameVoidPtrMap)))
+	    GameVoidPtrMap(&_arena);
+	const Assignment_f *my_alpha = new (_arena.allocate(sizeof(Assignment_f),
+							    __alignof__(Assignment_f)))
+	    Assignment_f(*alpha);
+	std::pair<Container::value_type*, bool> ins = _container.insert(std::make_pair(my_alpha, map));
+	if (!ins.second) { // inserted concurrently
+	    my_alpha->~Assignment_f();
+	    map->~GameVoidPtrMap();
+	}
+	res = ins.first;
     }
-    map = res.first->second;
-    map->update_value(game, val, _evaluation);
+    return res->second;
+}
+
+size_t
+SequoiaTable::allocated() const {
+    size_t bytes = _arena.allocated() + _container.allocated();
+    Container::const_iterator it;
+    for (it = _container.begin(); it != _container.end(); ++it)
+	bytes += it->second->allocated();
+    return bytes;
 }
 
 } // namespace
\ No newline at end of file
@@ -22,7 +22,9 @@
 #ifndef SEQUOIA_SEQUOIA_TABLE_H
 #define SEQUOIA_SEQUOIA_TABLE_H
 
+#include "arena.h"
 #include "evaluation.h"
+#include "flat_hash_map.h"
 #include "game.h"
 #include "hashing.h"
 #include "structures/treedecomposition.h"
@@ -41,6 +43,9 @@ namespace sequoia {
  * Map a game to the ring element under an evaluation;  The void *
  * is to be casted to arbitrary values by the evaluation we used.
  * Corresponds to $val(G)$ in the KLR11 paper, where G is the game.
+ *
+ * The map, its nodes and its keys live in the arena of the SequoiaTable
+ * it belongs to.
  */
 class GameVoidPtrMap {
 #ifdef HAVE_TBB
@@ -48,36 +53,77 @@ class GameVoidPtrMap {
 #else
     typedef const void* Value;
 #endif
-    typedef SEQUOIA_CONCUR_UNORDERED_MAP<
-	const MCGame_f*,
-	Value,
-        ptr_deep_hasher<MCGame_f, flyweight_inheritance_deep_hasher<MCGame> >,
-	ptr_deep_equals<const MCGame_f*>
-    > Container;
+    typedef flyweight_ptr_hasher<MCGame> Hasher;
+    typedef flyweight_ptr_equals<MCGame> Equals;
+    typedef FlatHashMap<const MCGame_f*, Value, Hasher, Equals> Container;
 public:
     typedef Container::value_type value_type;
     typedef Container::const_iterator const_iterator;
-    GameVoidPtrMap() { }
+    GameVoidPtrMap(Arena* arena)
+    : _container(arena), _arena(arena) { }
     ~GameVoidPtrMap() {
 	const_iterator it = begin();
 	const_iterator itend = end();
+	// the memory itself is released with the arena
 	for (; it != itend; it++)
-	    delete it->first;
+	    it->first->~MCGame_f();
     }
     const_iterator begin() const { return _container.begin(); }
     const_iterator end() const { return _container.end(); }
+    /**
+     * Number of bytes of the map's slots, its entries and games live in
+     * the table's arena.
+     */
+    size_t allocated() const { return _container.allocated(); }
     
+    /**
+     * Takes care of deleting the game, do not delete elsewhere!
+     */
     void update_value(const MCGame_f* game, const void *val,
 		      SequoiaInternalEvaluation *eval) {
+	update(game, true, val, eval);
+    }
+    /**
+     * Like update_value(), but the game remains owned by the caller.
+     * It is copied only if it is not in the map yet.
+     */
+    void update_value_borrowed(const MCGame_f* game, const void *val,
+			       SequoiaInternalEvaluation *eval) {
+	update(game, false, val, eval);
+    }
+private:
+    void update(const MCGame_f* game, bool owned, const void *val,
+		SequoiaInternalEvaluation *eval) {
         assert(game != NULL);
         if (game->get()->outcome() == MCGame::FALSIFIER) {
-            delete game;
+            if (owned)
+                delete game;
             return;
         }
 	Value save_value; // tbb atomic needs default init first
 	save_value = val;
-        GameVoidPtrMap::value_type entry(std::make_pair(game, save_value));
-        std::pair<Container::iterator, bool> res = _container.insert(entry);
+        std::pair<Container::value_type*, bool> res(_container.find(game), false);
+        if (res.first == NULL) {
+            // move (or copy) the game's reference into the arena
+            MCGame_f* handle = const_cast<MCGame_f*>(game);
+            MCGame_f* my_game = new (_arena->allocate(sizeof(MCGame_f),
+                                                      __alignof__(MCGame_f)))
+                MCGame_f();
+            if (owned)
+                my_game->swap(*handle);
+            else
+                *my_game = *game;
+            GameVoidPtrMap::value_type entry(std::make_pair(my_game, save_value));
+            res = _container.insert(entry);
+            if (res.second) {
+                if (owned)
+                    delete game; // empty handle
+            } else { // inserted concurrently
+                if (owned)
+                    handle->swap(*my_game);
+                my_game->~MCGame_f();
+            }
+        }
         if (!res.second) { // existing entry
 	    DEBUG({
 		std::cout << "duplicate entry for game: " << game->get()->toString() << std::endl;
@@ -85,7 +131,8 @@ public:
 		std::cout << "compare  value: " << eval->toString(val) << std::endl;
 	    });
 	    // clean up the game, no longer needed
-            delete game;
+            if (owned)
+                delete game;
 	    // existing entry, use _evaluation to decide compute new value
 #ifdef HAVE_TBB
 	    const void *oldval, *newval;
@@ -99,8 +146,9 @@ public:
         }
         DPRINTLN("update_value: new/old value: " << eval->toString(res.first->second));
     }
-private:
+
     Container _container;
+    Arena* _arena;
 };
 
 /**
@@ -109,29 +157,30 @@ private:
  * that is indexed by an Assignment.
  * This corresponds to the sets $S(\bar U)$ in the KLR11 paper,
  * where $\bar U$ is the SetMoves array.
+ *
+ * All memory of a table (the maps, their nodes and the key handles) is
+ * allocated from a per-table arena, so building the table is mostly
+ * pointer bumping and destroying it releases a few large chunks only.
  */
 class SequoiaTable {
 private:
-    typedef SEQUOIA_CONCUR_UNORDERED_MAP<
-        const Assignment_f*,
-        GameVoidPtrMap*,
-        ptr_deep_hasher<
-            Assignment_f,
-            flyweight_inheritance_deep_hasher<Assignment>
-        >,
-        ptr_deep_equals<const Assignment_f*>
-    > Container;
+    typedef flyweight_ptr_hasher<Assignment> Hasher;
+    typedef flyweight_ptr_equals<Assignment> Equals;
+    typedef FlatHashMap<const Assignment_f*, GameVoidPtrMap*, Hasher, Equals> Container;
 public:
     SequoiaTable(const TreeDecomposition* treedecomposition,
 		 const TreeDecomposition::vertex_descriptor& node,
 		 SequoiaInternalEvaluation *evaluation)
-    : _treedecomposition(treedecomposition), _node(node),
+    : _container(&_arena),
+      _treedecomposition(treedecomposition), _node(node),
       _evaluation(evaluation) { }
     ~SequoiaTable() {
+	// run the destructors to release the flyweights, the memory
+	// itself is released with the arena
 	Container::const_iterator it;
 	for(it = _container.begin(); it != _container.end(); it++) {
-            delete it->first;
-	    delete it->second;
+            it->first->~Assignment_f();
+	    it->second->~GameVoidPtrMap();
         }
     }
 
@@ -141,7 +190,10 @@ public:
     typedef Container::value_type value_type;
     const_iterator begin() const { return _container.begin(); }
     const_iterator end() const { return _container.end(); }
-    const_iterator find(const Assignment_f* alpha) const {
+    /**
+     * @return the entry of alpha, NULL if there is none
+     */
+    const value_type* find(const Assignment_f* alpha) const {
 	return _container.find(alpha);
     }
 
@@ -151,7 +203,26 @@ public:
     void update_value(const Assignment_f* alpha,
 		      const MCGame_f* game,
 		      const void* val);
+    /**
+     * Like update_value(), but the game remains owned by the caller.
+     */
+    void update_value_borrowed(const Assignment_f* alpha,
+			       const MCGame_f* game,
+			       const void* val);
+
+    /**
+     * Number of bytes allocated for this table:  the arena and the slots
+     * of the maps.
+     */
+    size_t allocated() const;
 private:
+    /**
+     * The map for alpha, created if not existing.
+     */
+    GameVoidPtrMap* map(const Assignment_f* alpha);
+
+    // must be destroyed after the containers allocating from it
+    Arena _arena;
     Container _container;
     const TreeDecomposition* _treedecomposition;
     const TreeDecomposition::vertex_descriptor _node;
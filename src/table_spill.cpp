@@ -0,0 +1,105 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "table_spill.h"
+#include "exceptions.h"
+
+#include <cstdlib>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+
+namespace sequoia {
+
+TableSpill::TableSpill(const std::string &directory, const FormulaIndex &index)
+: _index(index), _file(NULL), _size(0) {
+    std::string path = directory + "/sequoia-spill-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = ::mkstemp(&name[0]);
+    if (fd < 0)
+	throw sequoia_file_error("Cannot create spill file in " + directory);
+    ::unlink(&name[0]);
+    _file = ::fdopen(fd, "w+b");
+    if (_file == NULL) {
+	::close(fd);
+	throw sequoia_file_error("Cannot open spill file in " + directory);
+    }
+}
+
+TableSpill::~TableSpill() {
+    ::fclose(_file);
+}
+
+void
+TableSpill::write(const SequoiaTable *table) {
+    ObjectWriter writer(_index);
+    SequoiaTable::const_iterator it;
+    for (it = table->begin(); it != table->end(); ++it) {
+	writer.clear();
+	writer.put_alpha(it->first);
+	const GameVoidPtrMap *map = it->second;
+	uint32_t n = 0;
+	GameVoidPtrMap::const_iterator git;
+	for (git = map->begin(); git != map->end(); ++git)
+	    n++;
+	writer.put32(n);
+	for (git = map->begin(); git != map->end(); ++git) {
+	    const void *val = git->second;
+	    writer.put_game(git->first);
+	    writer.put64((uint64_t)(uintptr_t)val);
+	}
+	const std::string &record = writer.buffer();
+	uint32_t len = record.size();
+	if (::fwrite(&len, sizeof(len), 1, _file) != 1
+	    || ::fwrite(record.data(), 1, len, _file) != len)
+	    throw sequoia_file_error("Cannot write spill file");
+	_size += sizeof(len) + len;
+    }
+    if (::fflush(_file) != 0)
+	throw sequoia_file_error("Cannot write spill file");
+}
+
+void
+TableSpill::read(SequoiaTable *table) {
+    ::rewind(_file);
+    std::vector<char> record;
+    uint32_t len;
+    while (::fread(&len, sizeof(len), 1, _file) == 1) {
+	record.resize(len);
+	if (len > 0 && ::fread(&record[0], 1, len, _file) != len)
+	    throw sequoia_file_error("Cannot read spill file");
+	// the file was written by this process, it fits the formula
+	ObjectReader reader(_index, &record[0], len);
+	const Assignment_f *alpha = reader.get_alpha();
+	uint32_t n = reader.get32();
+	for (uint32_t i = 0; i < n; i++) {
+	    const MCGame_f *game = reader.get_game();
+	    const void *val = (const void*)(uintptr_t)reader.get64();
+	    table->update_value_borrowed(alpha, game, val);
+	}
+	reader.check_end();
+    }
+    if (::ferror(_file))
+	throw sequoia_file_error("Cannot read spill file");
+}
+
+} // namespace
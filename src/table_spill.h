@@ -0,0 +1,77 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_TABLE_SPILL_H
+#define	SEQUOIA_TABLE_SPILL_H
+
+#include "object_serializer.h"
+#include "sequoia_table.h"
+
+#include <cstdio>
+#include <string>
+
+namespace sequoia {
+
+/**
+ * The contents of a SequoiaTable, moved to a temporary file while the
+ * table is not needed, e.g., while a finished subtree waits for its
+ * join partner.  The file is removed from the directory right after it
+ * is created, so it vanishes with the process.
+ *
+ * For each assignment, the file holds one record with the assignment
+ * and its games written by an ObjectWriter, and the values.  Values are
+ * written as they are:  they are owned by the evaluation and outlive
+ * the table.  The games are re-interned when the table is read back.
+ */
+class TableSpill {
+public:
+    /**
+     * @param directory where to create the file
+     * @param index numbers the formulas and symbols the games refer to
+     */
+    TableSpill(const std::string &directory, const FormulaIndex &index);
+    ~TableSpill();
+
+    /**
+     * Write the contents of table to the file.
+     */
+    void write(const SequoiaTable *table);
+    /**
+     * Add the contents of the file to table, record by record.
+     */
+    void read(SequoiaTable *table);
+    /**
+     * Number of bytes written.
+     */
+    size_t size() const { return _size; }
+
+private:
+    TableSpill(const TableSpill&);
+    TableSpill& operator=(const TableSpill&);
+
+    const FormulaIndex &_index;
+    FILE *_file;
+    size_t _size;
+};
+
+} // namespace
+
+#endif	// SEQUOIA_TABLE_SPILL_H
@@ -23,6 +23,10 @@
 #include "../config.h"
 #include "unordered_defs.h"
 
+#ifndef HAVE_TBB
+#include <mutex>
+#endif
+
 namespace sequoia {
 
 namespace internal {
@@ -36,12 +40,18 @@ struct temporary_symbol_factory_t {
     const ConstantSymbol *get(unsigned int depth) {
 	ConstantSymbol *entry = new ConstantSymbol("___temporary___", depth, true);
 	std::pair<int, const ConstantSymbol*> e(depth, entry);
+#ifndef HAVE_TBB
+	std::lock_guard<std::mutex> lock(_mutex);
+#endif
 	std::pair<Container::const_iterator, bool> res = _container.insert(e);
 	if (!res.second)
 	    delete entry;
 	return res.first->second;
     }
     Container _container;
+#ifndef HAVE_TBB
+    std::mutex _mutex;
+#endif
 } temporary_symbol_factory;
 
 }
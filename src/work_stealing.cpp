@@ -0,0 +1,254 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#include "common.h"
+#include "numa_topology.h"
+#include "work_stealing.h"
+
+#include <cassert>
+
+namespace sequoia {
+
+namespace {
+// index of the worker the current thread acts as, -1 if none
+thread_local int current_worker = -1;
+}
+
+WorkStealingExecutor::WorkStealingExecutor(unsigned int num_threads,
+                                           const NumaTopology* topology)
+: _topology(topology), _active(0), _shutdown(false) {
+    _queued = 0;
+    _running = false;
+    _done = false;
+    _failed = false;
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+        num_threads = 1;
+    // distribute workers evenly over the nodes, in consecutive blocks
+    size_t num_nodes = topology != NULL ? topology->num_nodes() : 1;
+    for (unsigned int i = 0; i < num_threads; i++)
+        _workers.push_back(new Worker(i * num_nodes / num_threads));
+    // worker 0 is the thread calling run()
+    for (unsigned int i = 1; i < num_threads; i++)
+        _threads.push_back(std::thread(&WorkStealingExecutor::worker_loop, this, i));
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(_idle_mutex);
+        _shutdown = true;
+    }
+    _idle_cond.notify_all();
+    for (unsigned int i = 0; i < _threads.size(); i++)
+        _threads[i].join();
+    for (unsigned int i = 0; i < _workers.size(); i++)
+        delete _workers[i];
+}
+
+void WorkStealingExecutor::run(WorkStealingTask* root) {
+    assert(current_worker == -1);
+    assert(root->parent() == NULL);
+    // we act as worker 0 and run the root task, so the tables of our
+    // subtrees must be first touched on our node as well
+    ScopedThreadPin pin(_topology, _workers[0]->node);
+    _done = false;
+    _failed = false;
+    _exception = std::exception_ptr();
+    {
+        std::lock_guard<std::mutex> lock(_idle_mutex);
+        _running = true;
+    }
+    current_worker = 0;
+    execute(root);
+    while (!_done) {
+        work(0);
+        std::unique_lock<std::mutex> lock(_idle_mutex);
+        while (!_done && _queued == 0)
+            _idle_cond.wait(lock);
+    }
+    current_worker = -1;
+    {
+        // wait for the other workers to return to the idle loop
+        std::unique_lock<std::mutex> lock(_idle_mutex);
+        _running = false;
+        while (_active > 0)
+            _idle_cond.wait(lock);
+    }
+    assert(_queued == 0);
+    if (_exception)
+        std::rethrow_exception(_exception);
+}
+
+void WorkStealingExecutor::spawn(WorkStealingTask* t) {
+    assert(current_worker >= 0);
+    Worker* w = _workers[current_worker];
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->tasks.push_back(t);
+    }
+    _queued++;
+    if (_workers.size() > 1) {
+        // synchronize with workers about to wait, otherwise we might
+        // lose the wakeup
+        { std::lock_guard<std::mutex> lock(_idle_mutex); }
+        _idle_cond.notify_one();
+    }
+}
+
+void WorkStealingExecutor::worker_loop(unsigned int id) {
+    current_worker = id;
+    if (_topology != NULL)
+        _topology->pin_current_thread(_workers[id]->node);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_idle_mutex);
+            while (!_shutdown && !(_running && _queued > 0))
+                _idle_cond.wait(lock);
+            if (_shutdown)
+                return;
+            _active++;
+        }
+        work(id);
+        {
+            std::lock_guard<std::mutex> lock(_idle_mutex);
+            _active--;
+        }
+        _idle_cond.notify_all();
+    }
+}
+
+void WorkStealingExecutor::work(unsigned int id) {
+    while (!_done) {
+        WorkStealingTask* t = pop(id);
+        if (t == NULL)
+            t = steal(id);
+        if (t == NULL)
+            return;
+        execute(t);
+    }
+}
+
+WorkStealingTask* WorkStealingExecutor::pop(unsigned int id) {
+    Worker* w = _workers[id];
+    std::lock_guard<std::mutex> lock(w->mutex);
+    if (w->tasks.empty())
+        return NULL;
+    WorkStealingTask* t = w->tasks.back();
+    w->tasks.pop_back();
+    _queued--;
+    return t;
+}
+
+WorkStealingTask* WorkStealingExecutor::steal(unsigned int id) {
+    WorkStealingTask* t = steal(id, true);
+    if (t == NULL && _topology != NULL)
+        t = steal(id, false);
+    return t;
+}
+
+/**
+ * Steal the heaviest task at the front of another worker's deque,
+ * considering only workers on the same NUMA node if same_node is set
+ * (without topology, all workers are on the same node).
+ * The front is only peeked at first, so the victim may have changed
+ * by the time we take its front; we accept this (rare) imprecision.
+ */
+WorkStealingTask* WorkStealingExecutor::steal(unsigned int id, bool same_node) {
+    Worker* victim = NULL;
+    double heaviest = -1.0;
+    for (unsigned int i = 1; i < _workers.size(); i++) {
+        Worker* w = _workers[(id + i) % _workers.size()];
+        if ((w->node == _workers[id]->node) != same_node)
+            continue;
+        std::lock_guard<std::mutex> lock(w->mutex);
+        if (w->tasks.empty())
+            continue;
+        if (w->tasks.front()->weight() > heaviest) {
+            heaviest = w->tasks.front()->weight();
+            victim = w;
+        }
+    }
+    if (victim == NULL)
+        return NULL;
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (victim->tasks.empty())
+        return NULL;
+    WorkStealingTask* t = victim->tasks.front();
+    victim->tasks.pop_front();
+    _queued--;
+    return t;
+}
+
+/**
+ * Execute t and all tasks it returns for immediate execution.  Once a
+ * task completes, the reference count of its parent is decremented,
+ * and the last child to complete executes the parent.
+ * After a failure, tasks are no longer executed but only completed,
+ * so all pending tasks are released and the root eventually completes.
+ */
+void WorkStealingExecutor::execute(WorkStealingTask* t) {
+    while (t != NULL) {
+        WorkStealingTask* next = NULL;
+        if (!_failed) {
+            try {
+                next = t->execute(*this);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_idle_mutex);
+                if (!_failed) {
+                    _exception = std::current_exception();
+                    _failed = true;
+                }
+                next = NULL;
+                t->_recycled = false;
+            }
+        }
+        if (t->_recycled) {
+            assert(next == t);
+            t->_recycled = false;
+            continue;
+        }
+        WorkStealingTask* parent = t->_parent;
+        delete t;
+        if (parent == NULL) {
+            assert(next == NULL);
+            finish();
+            return;
+        }
+        if (--parent->_ref_count == 0) {
+            if (next == NULL)
+                next = parent;
+            else
+                spawn(parent);
+        }
+        t = next;
+    }
+}
+
+void WorkStealingExecutor::finish() {
+    {
+        std::lock_guard<std::mutex> lock(_idle_mutex);
+        _done = true;
+    }
+    _idle_cond.notify_all();
+}
+
+} // namespace
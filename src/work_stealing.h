@@ -0,0 +1,170 @@
+/*
+ * This file is part of the Sequoia MSO Solver.
+ *
+ * Copyright 2012 Alexander Langer, Theoretical Computer Science,
+ *                                  RWTH Aachen University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @author Alexander Langer
+ */
+#ifndef SEQUOIA_WORK_STEALING_H
+#define	SEQUOIA_WORK_STEALING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sequoia {
+
+class NumaTopology;
+class WorkStealingExecutor;
+
+/**
+ * A task for the WorkStealingExecutor.  Mimics the small subset of
+ * tbb::task that the dynamic programming scheduler relies on:
+ * continuations with a reference count, recycling a task as child of
+ * its continuation, and returning the next task to run ("bypass").
+ */
+class WorkStealingTask {
+public:
+    WorkStealingTask() : _parent(NULL), _weight(0.0), _recycled(false) {
+        _ref_count = 0;
+    }
+    virtual ~WorkStealingTask() { }
+
+    /**
+     * Run this task.
+     * @return a task to be executed next by the same worker, or NULL
+     */
+    virtual WorkStealingTask* execute(WorkStealingExecutor& executor) = 0;
+
+    WorkStealingTask* parent() const { return _parent; }
+    void set_ref_count(int count) { _ref_count = count; }
+    /**
+     * Estimated amount of work of this task.  Idle workers steal
+     * the heaviest task available.
+     */
+    double weight() const { return _weight; }
+    void weight(double w) { _weight = w; }
+
+    /**
+     * Make c the continuation of this task:  c replaces this task
+     * as child of this task's parent and will be run once all its
+     * children have completed.
+     */
+    void continue_with(WorkStealingTask* c) {
+        c->_parent = _parent;
+        _parent = NULL;
+    }
+    /**
+     * Re-use this task as child of c instead of destroying it
+     * after execute() returns.  Return this from execute() to run it
+     * again immediately.
+     */
+    void recycle_as_child_of(WorkStealingTask* c) {
+        _parent = c;
+        _recycled = true;
+    }
+    /**
+     * Set this task as child of c (before spawning it).
+     */
+    void child_of(WorkStealingTask* c) { _parent = c; }
+
+private:
+    friend class WorkStealingExecutor;
+    WorkStealingTask* _parent;
+    std::atomic<int> _ref_count;
+    double _weight;
+    bool _recycled;
+};
+
+/**
+ * A simple work-stealing executor based on C++11 threads, used as
+ * replacement for the TBB task scheduler if TBB is not available.
+ *
+ * Each worker owns a deque of tasks.  Spawned tasks are pushed to the
+ * back of the spawning worker's deque, the owner pops from the back
+ * (depth-first, cache friendly), idle workers steal the heaviest of the
+ * tasks at the front of the other workers' deques.
+ * The thread calling run() acts as worker 0.
+ *
+ * If a NUMA topology is given, workers are distributed evenly over the
+ * nodes and pinned to their node's processors (the calling thread only
+ * during run(), its affinity is restored afterwards).  Idle workers then steal
+ * from workers on their own node first, so a subtree, once stolen onto
+ * a node, and the tables allocated for it tend to stay there.
+ */
+class WorkStealingExecutor {
+public:
+    /**
+     * @param num_threads number of workers, 0 for all hardware threads
+     * @param topology if non-NULL, pin workers to the NUMA nodes
+     */
+    explicit WorkStealingExecutor(unsigned int num_threads = 0,
+                                  const NumaTopology* topology = NULL);
+    ~WorkStealingExecutor();
+
+    unsigned int num_threads() const { return _workers.size(); }
+
+    /**
+     * Execute root and all tasks spawned by it, and wait for root
+     * to complete.  Exceptions thrown by any task are re-thrown here.
+     */
+    void run(WorkStealingTask* root);
+
+    /**
+     * Schedule task t for execution.  Must be called from within
+     * a task executed by this executor.
+     */
+    void spawn(WorkStealingTask* t);
+
+private:
+    struct Worker {
+        Worker(size_t n) : node(n) { }
+        std::mutex mutex;
+        std::deque<WorkStealingTask*> tasks;
+        size_t node;
+    };
+
+    void worker_loop(unsigned int id);
+    void work(unsigned int id);
+    WorkStealingTask* pop(unsigned int id);
+    WorkStealingTask* steal(unsigned int id);
+    WorkStealingTask* steal(unsigned int id, bool same_node);
+    void execute(WorkStealingTask* t);
+    void finish();
+
+    std::vector<Worker*> _workers;
+    std::vector<std::thread> _threads;
+    const NumaTopology* _topology;
+
+    std::mutex _idle_mutex;
+    std::condition_variable _idle_cond;
+    std::atomic<size_t> _queued;   // number of tasks in all deques
+    std::atomic<bool> _running;    // run() is active
+    std::atomic<bool> _done;       // root task has completed
+    std::atomic<bool> _failed;     // a task has thrown, skip the rest
+    size_t _active;                // workers outside the idle loop
+    bool _shutdown;
+    std::exception_ptr _exception;
+};
+
+} // namespace
+
+#endif	/* SEQUOIA_WORK_STEALING_H */
@@ -0,0 +1,77 @@
+#include "arena.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <set>
+
+using namespace sequoia;
+
+TEST(ArenaTests, Allocate) {
+    Arena arena;
+    ASSERT_EQ(0u, arena.allocated());
+
+    char* a = static_cast<char*>(arena.allocate(10));
+    char* b = static_cast<char*>(arena.allocate(10));
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(b != NULL);
+    ASSERT_TRUE(a + 10 <= b || b + 10 <= a);
+    ASSERT_GT(arena.allocated(), 0u);
+
+    // the blocks are usable and do not overlap
+    memset(a, 'a', 10);
+    memset(b, 'b', 10);
+    for (unsigned int i = 0; i < 10; i++) {
+        ASSERT_EQ('a', a[i]);
+        ASSERT_EQ('b', b[i]);
+    }
+}
+
+TEST(ArenaTests, Alignment) {
+    Arena arena;
+    const size_t aligns[] = { 1, 2, 4, 8, 16 };
+    for (unsigned int round = 0; round < 100; round++)
+        for (unsigned int i = 0; i < sizeof(aligns) / sizeof(aligns[0]); i++) {
+            void* p = arena.allocate(round % 7 + 1, aligns[i]);
+            ASSERT_EQ(0u, reinterpret_cast<size_t>(p) % aligns[i]);
+        }
+    void* p = arena.allocate(1);
+    ASSERT_EQ(0u, reinterpret_cast<size_t>(p) % sizeof(void*));
+}
+
+TEST(ArenaTests, ManyChunks) {
+    Arena arena;
+    std::set<char*> blocks;
+    for (unsigned int i = 0; i < 10000; i++) {
+        char* p = static_cast<char*>(arena.allocate(64));
+        *p = (char)i;
+        ASSERT_TRUE(blocks.insert(p).second);
+    }
+    ASSERT_GE(arena.allocated(), 10000u * 64);
+    // the chunks grow, so there is little overhead
+    ASSERT_LT(arena.allocated(), 4u * 10000 * 64);
+}
+
+TEST(ArenaTests, LargeBlock) {
+    Arena arena;
+    char* small = static_cast<char*>(arena.allocate(8));
+    size_t before = arena.allocated();
+
+    // blocks larger than a chunk get a chunk of their own
+    const size_t large = 1 << 22;
+    char* p = static_cast<char*>(arena.allocate(large));
+    ASSERT_TRUE(p != NULL);
+    ASSERT_EQ(0u, reinterpret_cast<size_t>(p) % sizeof(void*));
+    ASSERT_GE(arena.allocated(), before + large);
+    memset(p, 0, large);
+
+    // ... and do not waste the current chunk
+    size_t after = arena.allocated();
+    char* next = static_cast<char*>(arena.allocate(8));
+    ASSERT_EQ(after, arena.allocated());
+    ASSERT_TRUE(next != small);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include "evaluation.h"
+#include "sequoia_solver.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+using namespace sequoia;
+
+namespace {
+
+const char* CACHE_FILE = "cache_persistent_unittest.cache";
+
+/**
+ * Solve dominating set on the grid with the cache file.
+ * @param loaded set to the number of cache entries loaded from the file
+ * @return the solution as printed by the evaluation
+ */
+std::string solve(size_t& loaded) {
+    SequoiaSolver solver;
+    solver.load_graph("grid-5x10.leda");
+    solver.formula("ds(U) := All x (x in U | Ex y (adj(x,y) & y in U))");
+    solver.load_evaluation("MinCard");
+    solver.cache_file(CACHE_FILE);
+
+    testing::internal::CaptureStdout();
+    solver.solve();
+    std::string out = testing::internal::GetCapturedStdout();
+
+    loaded = 0;
+    std::string::size_type pos = out.find("Loaded ");
+    EXPECT_NE(std::string::npos, pos);
+    if (pos != std::string::npos)
+        std::istringstream(out.substr(pos + 7)) >> loaded;
+
+    EXPECT_TRUE(solver.has_solution());
+    std::stringstream solution;
+    if (solver.has_solution())
+        solver.evaluation()->output_solution(solution, solver.solution());
+    return solution.str();
+}
+
+}
+
+TEST(CachePersistentTests, SecondRunLoadsEntries) {
+    std::remove(CACHE_FILE);
+    size_t first_loaded, second_loaded;
+    std::string first = solve(first_loaded);
+    std::string second = solve(second_loaded);
+    std::remove(CACHE_FILE);
+
+    ASSERT_EQ(0u, first_loaded);
+    ASSERT_GT(second_loaded, 0u);
+    ASSERT_FALSE(first.empty());
+    ASSERT_EQ(first, second);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
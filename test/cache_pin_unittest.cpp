@@ -0,0 +1,117 @@
+#include "cache.h"
+#include "cache_pin.h"
+#include "gtest/gtest.h"
+
+#include <functional>
+#include <utility>
+
+using namespace sequoia;
+
+namespace {
+
+struct Tracked {
+    explicit Tracked(int v) : v(v) { alive++; }
+    ~Tracked() { alive--; }
+    int v;
+    static int alive;
+};
+int Tracked::alive = 0;
+
+typedef internal::CacheEntryBase<Tracked> Entry;
+
+}
+
+TEST(CachePinTests, Empty) {
+    CachePin<Tracked> pin;
+    ASSERT_TRUE(pin.empty());
+    ASSERT_TRUE(pin.get() == NULL);
+    CachePin<Tracked> copy(pin);
+    ASSERT_TRUE(copy.empty());
+}
+
+TEST(CachePinTests, RefCounting) {
+    Tracked::alive = 0;
+    // the entry starts with the cache's reference
+    Entry* entry = new Entry(new Tracked(7));
+    entry->acquire();
+    {
+        CachePin<Tracked> pin(entry);
+        ASSERT_FALSE(pin.empty());
+        ASSERT_EQ(7, pin->v);
+        ASSERT_EQ(7, (*pin).v);
+        ASSERT_TRUE(pin.get() == entry->value());
+        {
+            entry->acquire();
+            CachePin<Tracked> other(entry);
+            ASSERT_EQ(1, Tracked::alive);
+        }
+        ASSERT_EQ(1, Tracked::alive);
+        // the cache drops the entry while pinned
+        entry->release();
+        ASSERT_EQ(1, Tracked::alive);
+        ASSERT_EQ(7, pin->v);
+    }
+    ASSERT_EQ(0, Tracked::alive);
+}
+
+TEST(CachePinTests, CopyMoveAssign) {
+    Tracked::alive = 0;
+    Entry* a = new Entry(new Tracked(1));
+    Entry* b = new Entry(new Tracked(2));
+    {
+        CachePin<Tracked> pa(a), pb(b); // adopt the initial references
+        CachePin<Tracked> copy(pa);
+        ASSERT_TRUE(copy.get() == pa.get());
+
+        CachePin<Tracked> moved(std::move(copy));
+        ASSERT_TRUE(copy.empty());
+        ASSERT_EQ(1, moved->v);
+
+        // the last reference to b goes away, a is still pinned twice
+        pb = pa;
+        ASSERT_EQ(1, Tracked::alive);
+        ASSERT_EQ(1, pb->v);
+
+        pa = CachePin<Tracked>();
+        ASSERT_TRUE(pa.empty());
+        moved = CachePin<Tracked>();
+        ASSERT_EQ(1, Tracked::alive);
+        ASSERT_EQ(1, pb->v);
+
+        pb = pb;
+        ASSERT_EQ(1, pb->v);
+    }
+    ASSERT_EQ(0, Tracked::alive);
+}
+
+TEST(CachePinTests, EvictedWhilePinned) {
+    Tracked::alive = 0;
+    internal::CacheCounter max_bytes;
+    max_bytes = 1 << 20;
+    FrequencySketch sketch;
+    {
+        internal::CacheImpl<int, Tracked, std::hash<int> > cache(&max_bytes, &sketch);
+        ASSERT_TRUE(cache.store(new int(1), new Tracked(1), 0));
+        CachePin<Tracked> pin = cache.lookup(1, 0);
+        ASSERT_FALSE(pin.empty());
+        ASSERT_TRUE(cache.lookup(3, 0).empty());
+
+        // make room for nothing, the next store evicts everything
+        max_bytes = 1;
+        for (int i = 0; i < 4; i++)
+            cache.lookup(2, 0);
+        cache.store(new int(2), new Tracked(2), 0);
+        ASSERT_EQ(0u, cache.size());
+        ASSERT_TRUE(cache.lookup(1, 0).empty());
+
+        ASSERT_EQ(1, Tracked::alive);
+        ASSERT_EQ(1, pin->v);
+        pin = CachePin<Tracked>();
+        ASSERT_EQ(0, Tracked::alive);
+    }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
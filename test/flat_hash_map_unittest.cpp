@@ -0,0 +1,164 @@
+#include "flat_hash_map.h"
+#include "gtest/gtest.h"
+
+#ifdef HAVE_TBB
+#include <tbb/atomic.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#endif
+
+#include <functional>
+#include <set>
+#include <vector>
+
+using namespace sequoia;
+
+namespace {
+
+struct IntHash {
+    size_t operator()(int key) const { return key; }
+};
+
+// all keys in the same group with the same tag, forces probing
+struct BadHash {
+    size_t operator()(int) const { return 42; }
+};
+
+typedef FlatHashMap<int, int, IntHash, std::equal_to<int> > Map;
+typedef FlatHashMap<int, int, BadHash, std::equal_to<int> > BadMap;
+
+}
+
+TEST(FlatHashMapTests, InsertFind) {
+    Arena arena;
+    Map map(&arena);
+    ASSERT_TRUE(map.empty());
+    ASSERT_TRUE(map.find(1) == NULL);
+    ASSERT_TRUE(map.begin() == map.end());
+
+    std::pair<Map::value_type*, bool> res = map.insert(Map::value_type(1, 10));
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(1, res.first->first);
+    ASSERT_EQ(10, res.first->second);
+    ASSERT_EQ(1u, map.size());
+
+    ASSERT_TRUE(map.find(1) == res.first);
+    ASSERT_TRUE(map.find(2) == NULL);
+    const Map& cmap = map;
+    ASSERT_TRUE(cmap.find(1) == res.first);
+
+    // the mapped value can be changed through the entry
+    res.first->second = 11;
+    ASSERT_EQ(11, map.find(1)->second);
+}
+
+TEST(FlatHashMapTests, DuplicateInsert) {
+    Arena arena;
+    Map map(&arena);
+    std::pair<Map::value_type*, bool> first = map.insert(Map::value_type(5, 50));
+    std::pair<Map::value_type*, bool> second = map.insert(Map::value_type(5, 51));
+    ASSERT_TRUE(first.second);
+    ASSERT_FALSE(second.second);
+    ASSERT_TRUE(first.first == second.first);
+    // the first value wins
+    ASSERT_EQ(50, second.first->second);
+    ASSERT_EQ(1u, map.size());
+}
+
+TEST(FlatHashMapTests, IterateAfterGrow) {
+    Arena arena;
+    Map map(&arena);
+    const int n = 1000; // grows several times from 16 slots
+    for (int i = 0; i < n; i++)
+        ASSERT_TRUE(map.insert(Map::value_type(i, 2 * i)).second);
+    ASSERT_EQ((size_t)n, map.size());
+
+    std::set<int> seen;
+    for (Map::const_iterator it = map.begin(); it != map.end(); ++it) {
+        ASSERT_EQ(2 * it->first, it->second);
+        ASSERT_TRUE(seen.insert(it->first).second);
+    }
+    ASSERT_EQ((size_t)n, seen.size());
+    ASSERT_EQ(0, *seen.begin());
+    ASSERT_EQ(n - 1, *seen.rbegin());
+
+    for (int i = 0; i < n; i++) {
+        ASSERT_TRUE(map.find(i) != NULL);
+        ASSERT_EQ(2 * i, map.find(i)->second);
+    }
+    ASSERT_TRUE(map.find(n) == NULL);
+    ASSERT_TRUE(map.find(-1) == NULL);
+}
+
+TEST(FlatHashMapTests, EntriesStableAcrossGrow) {
+    Arena arena;
+    Map map(&arena);
+    std::vector<Map::value_type*> entries;
+    for (int i = 0; i < 500; i++)
+        entries.push_back(map.insert(Map::value_type(i, i)).first);
+    for (int i = 0; i < 500; i++) {
+        ASSERT_TRUE(map.find(i) == entries[i]);
+        ASSERT_EQ(i, entries[i]->first);
+        ASSERT_EQ(i, entries[i]->second);
+    }
+}
+
+TEST(FlatHashMapTests, Collisions) {
+    Arena arena;
+    BadMap map(&arena);
+    for (int i = 0; i < 100; i++)
+        ASSERT_TRUE(map.insert(BadMap::value_type(i, i)).second);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_FALSE(map.insert(BadMap::value_type(i, -i)).second);
+        ASSERT_EQ(i, map.find(i)->second);
+    }
+    ASSERT_TRUE(map.find(100) == NULL);
+    ASSERT_EQ(100u, map.size());
+}
+
+#ifdef HAVE_TBB
+namespace {
+
+struct ConcurrentInsert {
+    ConcurrentInsert(Map* map, tbb::atomic<int>* inserted)
+    : map(map), inserted(inserted) { }
+    void operator()(const tbb::blocked_range<int>& r) const {
+        for (int i = r.begin(); i != r.end(); i++) {
+            // every key is inserted twice
+            int key = i / 2;
+            std::pair<Map::value_type*, bool> res = map->insert(Map::value_type(key, key));
+            ASSERT_EQ(key, res.first->first);
+            if (res.second)
+                (*inserted)++;
+            ASSERT_TRUE(map->find(key) == res.first);
+        }
+    }
+    Map* map;
+    tbb::atomic<int>* inserted;
+};
+
+}
+
+TEST(FlatHashMapTests, ConcurrentInsert) {
+    Arena arena;
+    Map map(&arena);
+    tbb::atomic<int> inserted;
+    inserted = 0;
+    const int n = 100000;
+    tbb::parallel_for(tbb::blocked_range<int>(0, 2 * n, 64),
+                      ConcurrentInsert(&map, &inserted));
+    ASSERT_EQ(n, inserted);
+    ASSERT_EQ((size_t)n, map.size());
+    size_t count = 0;
+    for (Map::const_iterator it = map.begin(); it != map.end(); ++it, count++)
+        ASSERT_EQ(it->first, it->second);
+    ASSERT_EQ((size_t)n, count);
+    for (int i = 0; i < n; i++)
+        ASSERT_TRUE(map.find(i) != NULL);
+}
+#endif
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
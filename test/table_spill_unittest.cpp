@@ -0,0 +1,100 @@
+#include "object_serializer.h"
+#include "sequoia_solver.h"
+#include "sequoia_table.h"
+#include "table_spill.h"
+#include "logic/assignment.h"
+#include "gtest/gtest.h"
+
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+#include <set>
+#include <string>
+
+using namespace sequoia;
+
+namespace {
+
+typedef boost::tuple<const Assignment*, const MCGame*, const void*> Entry;
+typedef std::set<Entry> Contents;
+
+/**
+ * The entries of table, by the pooled assignments and games.
+ */
+Contents contents(const SequoiaTable* table) {
+    Contents res;
+    SequoiaTable::const_iterator it;
+    for (it = table->begin(); it != table->end(); ++it) {
+        GameVoidPtrMap::const_iterator git;
+        for (git = it->second->begin(); git != it->second->end(); ++git)
+            res.insert(Entry(it->first->get(), git->first->get(), git->second));
+    }
+    return res;
+}
+
+/**
+ * Writes the child's table to a spill file and reads it back into a
+ * new table before each step of the dynamic programming.
+ */
+class SpillCheckSolver : public SequoiaSolver {
+public:
+    SpillCheckSolver() : tables(0), entries(0), mismatches(0) { }
+
+    void do_introduce(const TreeDecomposition::vertex_descriptor& child,
+                      const TreeDecomposition::vertex_descriptor& t) {
+        check(child);
+        SequoiaSolver::do_introduce(child, t);
+    }
+    void do_forget(const TreeDecomposition::vertex_descriptor& child,
+                   const TreeDecomposition::vertex_descriptor& t) {
+        check(child);
+        SequoiaSolver::do_forget(child, t);
+    }
+    void do_join(const TreeDecomposition::vertex_descriptor& left,
+                 const TreeDecomposition::vertex_descriptor& right,
+                 const TreeDecomposition::vertex_descriptor& t) {
+        check(left);
+        check(right);
+        SequoiaSolver::do_join(left, right, t);
+    }
+
+    unsigned int tables;
+    size_t entries;
+    unsigned int mismatches;
+
+private:
+    void check(const TreeDecomposition::vertex_descriptor& t) {
+        const SequoiaTable* table = this->table(t);
+        FormulaIndex index(formula());
+        TableSpill spill(".", index);
+        spill.write(table);
+        SequoiaTable copy(treedecomposition(), t, evaluation());
+        spill.read(&copy);
+        Contents expected = contents(table);
+        if (contents(&copy) != expected)
+            mismatches++;
+        tables++;
+        entries += expected.size();
+    }
+};
+
+}
+
+TEST(TableSpillTests, RoundTrip) {
+    SpillCheckSolver solver;
+    solver.threads(1);
+    solver.load_graph("grid-5x10.leda");
+    solver.formula("ds(U) := All x (x in U | Ex y (adj(x,y) & y in U))");
+    solver.load_evaluation("MinCard");
+    solver.solve();
+
+    ASSERT_TRUE(solver.has_solution());
+    ASSERT_GT(solver.tables, 0u);
+    ASSERT_GT(solver.entries, solver.tables);
+    ASSERT_EQ(0u, solver.mismatches);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,132 @@
+#include "moves_pool.h"
+#include "object_serializer.h"
+#include "parseformula.h"
+#include "logic/assignment.h"
+#include "logic/vocabulary.h"
+#include "gtest/gtest.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace sequoia;
+
+namespace {
+
+/**
+ * Finds the symbol with the given identifier in index.
+ */
+const Symbol* find_symbol(const FormulaIndex& index, const std::string& identifier) {
+    try {
+        for (uint32_t i = 0; ; i++)
+            if (identifier == index.symbol(i)->identifier())
+                return index.symbol(i);
+    } catch (const unknown_object&) { }
+    return NULL;
+}
+
+}
+
+TEST(BitSetTests, Operations) {
+    BitSet a;
+    a.set(0);
+    a.set(MOVE_WORD_BITS - 1);
+    a.set(MOVE_WORD_BITS);
+    ASSERT_TRUE(a.test(MOVE_WORD_BITS - 1));
+    ASSERT_FALSE(a.test(1));
+    ASSERT_FALSE(a.none());
+
+    // the shifts carry across words
+    BitSet up = a << 1;
+    ASSERT_TRUE(up.test(1));
+    ASSERT_TRUE(up.test(MOVE_WORD_BITS));
+    ASSERT_TRUE(up.test(MOVE_WORD_BITS + 1));
+    ASSERT_FALSE(up.test(0));
+    ASSERT_TRUE((up >> 1) == a);
+
+    BitSet range = BitSet::range(MOVE_WORD_BITS - 2, MOVE_WORD_BITS + 1);
+    for (unsigned int i = 0; i < move_bits(); i++)
+        ASSERT_EQ(i >= MOVE_WORD_BITS - 2 && i <= MOVE_WORD_BITS + 1, range.test(i));
+    BitSet inside = a & range;
+    ASSERT_FALSE(inside.test(0));
+    ASSERT_TRUE(inside.test(MOVE_WORD_BITS));
+    ASSERT_TRUE(((a & ~range) | inside) == a);
+
+    BitSet copy(a);
+    copy.reset(MOVE_WORD_BITS);
+    ASSERT_TRUE(copy != a);
+    copy = a;
+    ASSERT_TRUE(copy == a);
+    ASSERT_EQ(a.hash(), copy.hash());
+}
+
+TEST(ObjectSerializerTests, MovesOfSeveralWords) {
+    // enough symbols that the moves need two words
+    const unsigned int n = MOVE_WORD_BITS + 8;
+    Vocabulary* voc = new Vocabulary();
+    voc->add_symbol(new Symbol("adj", 2, false, 0));
+    for (unsigned int i = 0; i < n; i++) {
+        std::stringstream s;
+        s << "t" << i;
+        voc->add_constant_symbol(s.str(), false);
+    }
+    Formula* f = parse_string(voc, "f(U) := Ex X All x (x in X or x in U)");
+    ASSERT_TRUE(f != NULL);
+    FormulaIndex index(f);
+    const UnarySymbol* U = static_cast<const UnarySymbol*>(find_symbol(index, "U"));
+    const UnarySymbol* X = static_cast<const UnarySymbol*>(find_symbol(index, "X"));
+    const ConstantSymbol* x = static_cast<const ConstantSymbol*>(find_symbol(index, "x"));
+    ASSERT_TRUE(U != NULL && X != NULL && x != NULL);
+    ASSERT_GT(X->nesting_depth(), MOVE_WORD_BITS + 5);
+
+    SetMove* smove = new SetMove(X);
+    smove->add(1);
+    smove->add(MOVE_WORD_BITS - 1);
+    smove->add(MOVE_WORD_BITS);
+    smove->add(MOVE_WORD_BITS + 5);
+    const SetMove* pooled_smove = moves_pool.pool(smove);
+    PointMove* pmove = new PointMove(x);
+    pmove->add_label(U);
+    pmove->add_label(X);
+    pmove->add_edge(2);
+    pmove->add_edge(MOVE_WORD_BITS + 3);
+    const PointMove* pooled_pmove = moves_pool.pool(pmove);
+
+    boost::scoped_ptr<const Assignment_f> empty(AssignmentFlyFactory::make(new EmptyAssignment()));
+    boost::scoped_ptr<const Assignment_f> with_set(
+        AssignmentFlyFactory::make(SetAssignment::make(empty.get(), X, pooled_smove)));
+    boost::scoped_ptr<const Assignment_f> alpha(
+        AssignmentFlyFactory::make(ObjAssignment::make(with_set.get(), x, pooled_pmove)));
+
+    ObjectWriter writer(index);
+    writer.put_alpha(alpha.get());
+    writer.put_alpha(alpha.get()); // a reference
+    ObjectReader reader(index, writer.buffer().data(), writer.buffer().size());
+    const Assignment_f* read = reader.get_alpha();
+    ASSERT_TRUE(reader.get_alpha() == read);
+    reader.check_end();
+
+    // the moves are pooled, so the assignment is the same
+    ASSERT_TRUE(read->get() == alpha->get());
+    const SetMove* rsmove = read->get()->get(X);
+    const PointMove* rpmove = read->get()->get(x);
+    ASSERT_TRUE(*rsmove == *pooled_smove);
+    ASSERT_TRUE(*rpmove == *pooled_pmove);
+    for (unsigned int i = 0; i < X->nesting_depth(); i++)
+        ASSERT_EQ(pooled_smove->test(i), rsmove->test(i));
+    ASSERT_EQ(4u, rsmove->size());
+    ASSERT_TRUE(rsmove->test(MOVE_WORD_BITS + 5));
+    for (unsigned int i = 0; i < x->nesting_depth(); i++) {
+        ASSERT_EQ(pooled_pmove->test_label(i), rpmove->test_label(i));
+        ASSERT_EQ(pooled_pmove->test_edge(i), rpmove->test_edge(i));
+    }
+    ASSERT_TRUE(rpmove->test_edge(MOVE_WORD_BITS + 3));
+}
+
+int main(int argc, char **argv) {
+  // before any moves are created
+  set_move_words(2);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}